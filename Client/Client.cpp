@@ -1,30 +1,48 @@
 // Client.cpp
 
 #include <iostream>
+#include <fstream>
+#include <map>
 #include <thread>
+#include <memory>
 #include <mutex>
-#include <condition_variable>
-#include <queue>
 #include <string>
 #include <atomic>
 #include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <set>
 #include <unistd.h>
 #include <sys/socket.h>
 #include <arpa/inet.h>
 #include <glog/logging.h>
 #include <csignal> // exit signal handling
 #include "Message/MySocket.h" // 引入封装的Socket类
+#include "Message/SpscQueue.h" // 生产者/消费者之间的无锁队列
+#include "Message/StreamChunk.h" // 文件分块传输
+#include "Message/Compression.h" // 压缩协商与解压
+#include "Message/Fragment.h" // 大数据包分片重组
+#include "Message/Scan.h" // 显示前转义消息文本
 #include <limits>
 
 // 定义服务器地址和端口
 #define SERVER_ADDRESS "127.0.0.1"
 #define SERVER_PORT 5869
+#define MSG_QUEUE_CAPACITY 4096 // 接收队列容量（必须足以吸收突发转发流量）
 
 // 全局变量
-std::mutex mtx;
-std::condition_variable cv;
-std::queue<Packet> msgQueue;
+std::unique_ptr<SpscQueue<Packet>> msgQueue; // producer -> consumer，单生产者单消费者
 std::atomic<bool> running(true);
+std::mutex sendMutex; // 输入线程与消费者线程（发送 GRANT_CREDIT）共用同一个 socket
+PacketCodec codec; // 接收方向的解压上下文，只在生产者线程中使用
+FragmentAssembler fragments; // 分片重组，同样只在生产者线程中使用
+std::atomic<bool> compressionEnabled(false); // 服务器接受了压缩协商
+
+// 发送数据包到服务器（线程安全）
+void sendToServer(MySocket& clientSocketObj, const Packet& pkt) {
+    std::lock_guard<std::mutex> lock(sendMutex);
+    clientSocketObj.sendPacket(pkt);
+}
 
 // 生产者线程：接收服务器数据
 int recvtime=0;
@@ -32,69 +50,176 @@ void producer(MySocket& clientSocketObj, int localPort) {
     try {
         while (running) {
             Packet received = clientSocketObj.recvPacket();
-            Packet pkt;
-            pkt.type = received.type;
-            pkt.data = received.data;
+            if (!fragments.add(received, codec, DEFAULT_MAX_FRAME_SIZE)) {
+                continue; // 分片未收齐
+            }
 
-            // 将数据包放入队列
-            {
-                std::lock_guard<std::mutex> lock(mtx);
-                msgQueue.push(pkt);
+            // 将数据包移动进队列（不拷贝），消费者休眠时才会被唤醒
+            if (!msgQueue->push(std::move(received))) {
+                break; // 队列已关闭
             }
-            cv.notify_one(); // 通知消费者
         }
     } catch (const std::exception& e) {
         if (running) { // 仅在未请求退出时记录错误
             LOG(INFO) << "Producer thread exiting. Reason: " << e.what();
             running = false;
-            cv.notify_all();
         }
     }
+    msgQueue->close(); // 唤醒消费者，让其处理完剩余数据后退出
 }
 
-// 消费者线程：处理并显示数据
-void consumer(int localPort) {
-    int messageCount = 0; // 计数器，记录接收的消息次数
-    while (running) {
-        std::unique_lock<std::mutex> lock(mtx);
-        cv.wait(lock, []{ return !msgQueue.empty() || !running; });
+// 连接后协商压缩和分片（在启动收发线程之前同步完成）。服务器可能先推送转发的消息，它们照常交给消费者
+void negotiateFeatures(MySocket& clientSocketObj, bool compress) {
+    Packet hello;
+    hello.type = HELLO;
+    hello.data = compress ? COMPRESSION_CODEC "," PACKET_FEATURE_FRAGMENTS : PACKET_FEATURE_FRAGMENTS;
+    clientSocketObj.sendPacket(hello);
+    while (true) {
+        Packet received = clientSocketObj.recvPacket();
+        if (!fragments.add(received, codec, DEFAULT_MAX_FRAME_SIZE)) {
+            continue;
+        }
+        if (received.type == RESPONSE) {
+            compressionEnabled = helloAccepted(received.data, COMPRESSION_CODEC);
+            LOG(INFO) << "Compression: " << (compressionEnabled ? COMPRESSION_CODEC : "none");
+            return;
+        }
+        msgQueue->push(std::move(received));
+    }
+}
 
-        while (!msgQueue.empty()) {
-            Packet pkt = msgQueue.front();
-            msgQueue.pop();
-            lock.unlock();
+// 处理收到的文件分块：保存为当前目录下的 recv_<发送方ID>_<流ID>_<文件名>
+struct IncomingFile {
+    std::string path;
+    std::ofstream out;
+    uint64_t bytes = 0;
+};
 
-            // 处理数据包，例如显示给用户
-            if (pkt.type == SEND_MESSAGE) {
-                messageCount++;
-                std::cout << "\n====================\n";
-                std::cout << "[来自其他客户端的消息 #" << messageCount << "]: " << pkt.data << std::endl;
-                std::cout << "====================\n";
-                LOG(INFO) << "Received message #" << messageCount 
-                          << " from server (Client Local Port: " << localPort << ").";
-            } else if (pkt.type == CLIENT_LIST) {
-                std::cout << "\n====================\n";
-                std::cout << "[在线客户端列表]:\n" << pkt.data << std::endl;
-                std::cout << "====================\n";
-                LOG(INFO) << "Received client list from server (Client Local Port: " 
-                          << localPort << ").";
-            } else if (pkt.type == RESPONSE) {
-                std::cout << "\n====================\n";
-                recvtime++;
-                std::cout << "[服务器响应]: " << pkt.data << std::endl;
-                std::cout<<"recvtime=="<<recvtime<<std::endl;
-                std::cout << "====================\n";
-                LOG(INFO) << "Received response from server: " << pkt.data 
-                          << " (Client Local Port: " << localPort << ").";
-            } else {
-                std::cout << "\n====================\n";
-                std::cout << "[未知消息类型]: " << pkt.data << std::endl;
-                std::cout << "====================\n";
-                LOG(INFO) << "Received unknown packet type: " << pkt.type 
-                          << " (Client Local Port: " << localPort << ").";
-            }
+void handleStreamChunk(std::map<std::pair<uint32_t, uint32_t>, IncomingFile>& files, const StreamChunk& chunk) {
+    std::pair<uint32_t, uint32_t> key(chunk.peerId, chunk.streamId);
+    if (chunk.flags & STREAM_FLAG_ABORT) {
+        // 发送的文件无法投递时服务器对每个分块都会回送中止，只显示一次
+        static std::set<std::pair<uint32_t, uint32_t>> reported;
+        if (!reported.insert(key).second) {
+            return;
+        }
+        auto it = files.find(key);
+        std::cout << "\n[文件传输中止] 客户端 " << chunk.peerId << "，流 " << chunk.streamId 
+                  << ": " << chunk.payload << std::endl;
+        if (it != files.end()) {
+            it->second.out.close();
+            std::remove(it->second.path.c_str());
+            files.erase(it);
+        }
+        return;
+    }
+    if (chunk.flags & STREAM_FLAG_BEGIN) {
+        std::string name = chunk.payload.substr(chunk.payload.find_last_of('/') + 1);
+        IncomingFile& file = files[key];
+        file.path = "recv_" + std::to_string(chunk.peerId) + "_" + std::to_string(chunk.streamId) + "_" + name;
+        file.out.open(file.path, std::ios::binary | std::ios::trunc);
+        std::cout << "\n[开始接收文件] 来自客户端 " << chunk.peerId << ": " << file.path << std::endl;
+    } else {
+        auto it = files.find(key);
+        if (it == files.end()) {
+            return; // 未收到开始分块（例如中途连接）
+        }
+        it->second.out.write(chunk.payload.data(), chunk.payload.size());
+        it->second.bytes += chunk.payload.size();
+    }
+    if (chunk.flags & STREAM_FLAG_END) {
+        IncomingFile& file = files[key];
+        file.out.close();
+        std::cout << "\n[文件接收完成] " << file.path << " (" << file.bytes << " 字节)" << std::endl;
+        LOG(INFO) << "Received file " << file.path << " (" << file.bytes << " bytes) from client " << chunk.peerId;
+        files.erase(key);
+    }
+}
 
-            lock.lock();
+// 把文件分块发送给目标客户端（阻塞 socket 自然限速：服务器转发不过来时 send 会阻塞）
+void sendFile(MySocket& clientSocketObj, uint32_t targetId, const std::string& path) {
+    static uint32_t nextStreamId = 1;
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        std::cout << "无法打开文件: " << path << std::endl;
+        return;
+    }
+    StreamChunk chunk;
+    chunk.peerId = targetId;
+    chunk.streamId = nextStreamId++;
+    chunk.flags = STREAM_FLAG_BEGIN;
+    chunk.payload = path;
+    sendToServer(clientSocketObj, chunk.toPacket());
+
+    uint64_t total = 0;
+    std::string buffer(STREAM_CHUNK_SIZE, '\0');
+    chunk.flags = 0;
+    while (in.read(&buffer[0], buffer.size()) || in.gcount() > 0) {
+        chunk.payload.assign(buffer.data(), in.gcount());
+        sendToServer(clientSocketObj, chunk.toPacket());
+        total += in.gcount();
+    }
+    chunk.flags = STREAM_FLAG_END;
+    chunk.payload.clear();
+    sendToServer(clientSocketObj, chunk.toPacket());
+    std::cout << "文件已发送: " << path << " (" << total << " 字节)" << std::endl;
+    LOG(INFO) << "Sent file " << path << " (" << total << " bytes) to client " << targetId;
+}
+
+// 消费者线程：处理并显示数据
+void consumer(MySocket& clientSocketObj, int localPort) {
+    int messageCount = 0; // 计数器，记录接收的消息次数
+    std::map<std::pair<uint32_t, uint32_t>, IncomingFile> files; // (发送方, 流ID) -> 正在接收的文件
+    StreamChunk chunk;
+    Packet pkt;
+    // waitPop 在队列关闭且取空后返回 false
+    while (msgQueue->waitPop(pkt)) {
+        // 处理数据包，例如显示给用户
+        if (pkt.type == SEND_MESSAGE) {
+            messageCount++;
+            std::cout << "\n====================\n";
+            // 压缩转发或拼接转发的消息不经服务器检查，显示前把控制字符和非法字节转义
+            std::cout << "[来自其他客户端的消息 #" << messageCount << "]: " << escapeText(pkt.data) << std::endl;
+            std::cout << "====================\n";
+            LOG(INFO) << "Received message #" << messageCount 
+                      << " from server (Client Local Port: " << localPort << ").";
+            // 消息已处理完，归还一份转发信用给服务器
+            Packet grant;
+            grant.type = GRANT_CREDIT;
+            grant.data = "1";
+            try {
+                sendToServer(clientSocketObj, grant);
+            } catch (const std::exception& e) {
+                LOG(ERROR) << "发送信用确认失败: " << e.what();
+            }
+        } else if (pkt.type == STREAM_CHUNK && StreamChunk::parse(pkt.data, chunk)) {
+            handleStreamChunk(files, chunk);
+        } else if (pkt.type == CLIENT_LIST) {
+            std::cout << "\n====================\n";
+            std::cout << "[在线客户端列表]:\n" << pkt.data << std::endl;
+            std::cout << "====================\n";
+            LOG(INFO) << "Received client list from server (Client Local Port: " 
+                      << localPort << ").";
+        } else if (pkt.type == BACKPRESSURE) {
+            std::cout << "\n====================\n";
+            std::cout << "[消息被拒绝，接收方处理不过来]: " << pkt.data << std::endl;
+            std::cout << "====================\n";
+            LOG(WARNING) << "Message rejected by server flow control: " << pkt.data 
+                         << " (Client Local Port: " << localPort << ").";
+        } else if (pkt.type == RESPONSE) {
+            std::cout << "\n====================\n";
+            recvtime++;
+            std::cout << "[服务器响应]: " << pkt.data << std::endl;
+            std::cout<<"recvtime=="<<recvtime<<std::endl;
+            std::cout << "====================\n";
+            LOG(INFO) << "Received response from server: " << pkt.data 
+                      << " (Client Local Port: " << localPort << ").";
+        } else {
+            std::cout << "\n====================\n";
+            std::cout << "[未知消息类型]: " << escapeText(pkt.data) << std::endl;
+            std::cout << "====================\n";
+            LOG(INFO) << "Received unknown packet type: " << pkt.type 
+                      << " (Client Local Port: " << localPort << ").";
         }
     }
 }
@@ -109,8 +234,9 @@ void printMenu() {
     std::cout << "4. 获取在线客户端列表" << std::endl;
     std::cout << "5. 断开连接" << std::endl;
     std::cout << "6. 退出" << std::endl;
+    std::cout << "7. 发送文件到其他客户端" << std::endl;
     std::cout << "====================\n";
-    std::cout << "请输入选项 (1-6): ";
+    std::cout << "请输入选项 (1-7): ";
 }
 
 // 输入处理函数（运行在单独的线程）
@@ -157,6 +283,10 @@ void handleUserInput(MySocket& clientSocketObj, int localPort, std::atomic<bool>
                 std::getline(std::cin, message);
                 pkt.type = SEND_MESSAGE;
                 pkt.data = targetIdStr + ":" + message; // 格式化为 "targetId:message"
+                if (compressionEnabled) {
+                    // 用共享字典压缩消息部分，服务器可以原样转发给接收方
+                    PacketCodec::compressRelayable(pkt, COMPRESS_MIN_BYTES);
+                }
                 break;
             }
             case 4: { // 获取在线客户端列表
@@ -168,13 +298,13 @@ void handleUserInput(MySocket& clientSocketObj, int localPort, std::atomic<bool>
                 pkt.type = DISCONNECT;
                 pkt.data = "";
                 try {
-                    clientSocketObj.sendPacket(pkt);
+                    sendToServer(clientSocketObj, pkt);
                     LOG(INFO) << "Sent DISCONNECT request.";
                 } catch (const std::exception& e) {
                     LOG(ERROR) << "发送断开请求失败: " << e.what();
                 }
                 runningFlag = false;
-                cv.notify_all();
+                msgQueue->close();
                 shouldBreak = true;
                 break;
             }
@@ -184,17 +314,40 @@ void handleUserInput(MySocket& clientSocketObj, int localPort, std::atomic<bool>
                     pkt.type = DISCONNECT;
                     pkt.data = "";
                     try {
-                        clientSocketObj.sendPacket(pkt);
+                        sendToServer(clientSocketObj, pkt);
                         LOG(INFO) << "Sent DISCONNECT request.";
                     } catch (const std::exception& e) {
                         LOG(ERROR) << "发送断开请求失败: " << e.what();
                     }
                 }
                 runningFlag = false;
-                cv.notify_all();
+                msgQueue->close();
                 shouldBreak = true;
                 break;
             }
+            case 7: { // 发送文件
+                uint32_t targetId;
+                std::string path;
+                std::cout << "请输入目标客户端ID: ";
+                if (!(std::cin >> targetId)) {
+                    std::cin.clear();
+                    std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+                    std::cout << "输入无效。" << std::endl;
+                    continue;
+                }
+                std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+                std::cout << "请输入文件路径: ";
+                std::getline(std::cin, path);
+                try {
+                    sendFile(clientSocketObj, targetId, path);
+                } catch (const std::exception& e) {
+                    LOG(ERROR) << "发送文件失败: " << e.what();
+                    runningFlag = false;
+                    msgQueue->close();
+                    shouldBreak = true;
+                }
+                break;
+            }
             default: {
                 std::cout << "无效的选项，请重新选择。" << std::endl;
                 continue;
@@ -207,18 +360,18 @@ void handleUserInput(MySocket& clientSocketObj, int localPort, std::atomic<bool>
                 if(choice==1){
                 int times;
                 for(times=1;times<=100;times++){
-                    clientSocketObj.sendPacket(pkt);
+                    sendToServer(clientSocketObj, pkt);
                 }
                 std::cout << "send to server times =" <<times <<std::endl;
                 }
                 else{
-                    clientSocketObj.sendPacket(pkt);
+                    sendToServer(clientSocketObj, pkt);
                     LOG(INFO) << "已发送请求类型 " << pkt.type;
                 }
             } catch (const std::exception& e) {
                 LOG(ERROR) << "发送数据失败: " << e.what();
                 runningFlag = false;
-                cv.notify_all();
+                msgQueue->close();
                 break;
             }
         }
@@ -238,20 +391,38 @@ int main(int argc, char* argv[]) {
     FLAGS_stop_logging_if_full_disk = true;
     google::InstallFailureSignalHandler();
 
+    // --busy-poll：消费者线程自旋等待，不在 eventfd 上休眠（适用于延迟敏感场景）
+    // --port=PORT：连接集群中的其他节点
+    // --no-compress：不协商压缩
+    bool busyPoll = false;
+    bool compress = true;
+    uint16_t serverPort = SERVER_PORT;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--busy-poll") == 0) {
+            busyPoll = true;
+        } else if (std::strncmp(argv[i], "--port=", 7) == 0) {
+            serverPort = static_cast<uint16_t>(std::atoi(argv[i] + 7));
+        } else if (std::strcmp(argv[i], "--no-compress") == 0) {
+            compress = false;
+        }
+    }
+    msgQueue.reset(new SpscQueue<Packet>(MSG_QUEUE_CAPACITY, busyPoll));
+
     MySocket clientSocketObj;
 
     // 用户输入连接请求
     std::cout << "=== 客户端启动 ===" << std::endl;
-    std::cout << "是否连接到服务器 " << SERVER_ADDRESS << ":" << SERVER_PORT << "? (y/n): ";
+    std::cout << "是否连接到服务器 " << SERVER_ADDRESS << ":" << serverPort << "? (y/n): ";
     char connectChoice;
     std::cin >> connectChoice;
     std::cin.ignore(); // 忽略剩余的换行符
 
     if (connectChoice == 'y' || connectChoice == 'Y') {
-        std::cout << "正在连接到服务器 " << SERVER_ADDRESS << ":" << SERVER_PORT << " ..." << std::endl;
+        std::cout << "正在连接到服务器 " << SERVER_ADDRESS << ":" << serverPort << " ..." << std::endl;
         try {
             // 连接到服务器
-            clientSocketObj.connectTo(SERVER_ADDRESS, SERVER_PORT);
+            clientSocketObj.connectTo(SERVER_ADDRESS, serverPort);
+            negotiateFeatures(clientSocketObj, compress);
         } catch (const std::exception& e) {
             LOG(FATAL) << "[Error] " << e.what();
         }
@@ -264,12 +435,12 @@ int main(int argc, char* argv[]) {
         }
         int localPort = ntohs(localAddress.sin_port);
 
-        LOG(INFO) << "[Info] 已连接到服务器 " << SERVER_ADDRESS << ":" << SERVER_PORT 
+        LOG(INFO) << "[Info] 已连接到服务器 " << SERVER_ADDRESS << ":" << serverPort 
                   << " (Client Local Port: " << localPort << ").";
 
         // 启动生产者和消费者线程
         std::thread prod(producer, std::ref(clientSocketObj), localPort);
-        std::thread cons(consumer, localPort);
+        std::thread cons(consumer, std::ref(clientSocketObj), localPort);
 
         // 启动用户输入线程
         std::thread inputThread(handleUserInput, std::ref(clientSocketObj), localPort, std::ref(running));
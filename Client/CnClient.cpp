@@ -0,0 +1,679 @@
+// CnClient.cpp
+
+#include "CnClient.h"
+#include <algorithm>
+#include <cerrno>
+#include <stdexcept>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <glog/logging.h>
+
+#define REACTOR_MAX_EVENTS 64
+#define REACTOR_TICK_MS 100   // 超时/重连检查的最大间隔
+#define READ_CHUNK_SIZE 65536
+
+namespace {
+
+// 延迟追踪按请求类型分别汇总
+const char* tracePath(MessageType type) {
+    switch (type) {
+    case GET_TIME: return "get_time";
+    case GET_NAME: return "get_name";
+    case SEND_MESSAGE: return "send_message";
+    case LIST_CLIENTS: return "list_clients";
+    case DISCONNECT: return "disconnect";
+    default: return "request";
+    }
+}
+
+} // namespace
+
+// ==================== ClientReactor ====================
+
+ClientReactor::ClientReactor() : running(false), loopThreadId(std::thread::id()) {
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd < 0) {
+        throw std::runtime_error("Failed to create epoll instance.");
+    }
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeFd < 0) {
+        close(epollFd);
+        throw std::runtime_error("Failed to create eventfd.");
+    }
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = nullptr; // nullptr 表示唤醒事件
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &ev);
+}
+
+ClientReactor::~ClientReactor() {
+    stop();
+    if (loopThread.joinable()) {
+        loopThread.join();
+    }
+    close(wakeFd);
+    close(epollFd);
+}
+
+void ClientReactor::startThread() {
+    if (loopThreadId.load() != std::thread::id()) {
+        throw std::runtime_error("ClientReactor is already driven by another thread.");
+    }
+    running = true;
+    loopThread = std::thread([this] { run(); });
+    // 立即绑定，避免线程启动前的 runSync 在调用线程中执行
+    bindLoopThread(loopThread.get_id());
+}
+
+void ClientReactor::run() {
+    running = true;
+    bindLoopThread(std::this_thread::get_id());
+    while (running) {
+        poll(REACTOR_TICK_MS);
+    }
+    // 处理完已投递的任务后解除绑定；检查队列为空与解除绑定在同一把锁内，
+    // 保证 runSync 投递的任务要么在这里被执行，要么由 runSync 在调用线程中执行
+    while (true) {
+        drainPosted();
+        std::lock_guard<std::mutex> lock(postMutex);
+        if (posted.empty()) {
+            loopThreadId = std::thread::id();
+            break;
+        }
+    }
+}
+
+void ClientReactor::stop() {
+    running = false;
+    uint64_t one = 1;
+    ssize_t ret = write(wakeFd, &one, sizeof(one));
+    (void)ret;
+}
+
+void ClientReactor::bindLoopThread(std::thread::id id) {
+    std::thread::id expected;
+    if (!loopThreadId.compare_exchange_strong(expected, id) && expected != id) {
+        throw std::runtime_error("ClientReactor is already driven by another thread.");
+    }
+}
+
+int ClientReactor::poll(int timeoutMs) {
+    bindLoopThread(std::this_thread::get_id());
+    struct epoll_event events[REACTOR_MAX_EVENTS];
+    int n = epoll_wait(epollFd, events, REACTOR_MAX_EVENTS, std::min(timeoutMs, REACTOR_TICK_MS));
+    if (n < 0 && errno != EINTR) {
+        LOG(ERROR) << "epoll_wait failed: " << strerror(errno);
+    }
+    for (int i = 0; i < n; i++) {
+        IoHandler* handler = static_cast<IoHandler*>(events[i].data.ptr);
+        if (handler == nullptr) {
+            uint64_t value;
+            ssize_t ret = read(wakeFd, &value, sizeof(value));
+            (void)ret;
+            continue;
+        }
+        handler->onEvents(events[i].events);
+    }
+    drainPosted();
+
+    auto now = std::chrono::steady_clock::now();
+    std::vector<TickHandler*> snapshot(tickers.begin(), tickers.end());
+    for (TickHandler* ticker : snapshot) {
+        if (tickers.count(ticker)) {
+            ticker->onTick(now);
+        }
+    }
+    return n < 0 ? 0 : n;
+}
+
+void ClientReactor::drainPosted() {
+    std::vector<std::function<void()>> tasks;
+    {
+        std::lock_guard<std::mutex> lock(postMutex);
+        tasks.swap(posted);
+    }
+    for (auto& task : tasks) {
+        task();
+    }
+}
+
+void ClientReactor::post(std::function<void()> fn) {
+    {
+        std::lock_guard<std::mutex> lock(postMutex);
+        posted.push_back(std::move(fn));
+    }
+    uint64_t one = 1;
+    ssize_t ret = write(wakeFd, &one, sizeof(one));
+    (void)ret;
+}
+
+void ClientReactor::runSync(const std::function<void()>& fn) {
+    if (inLoopThread()) {
+        fn();
+        return;
+    }
+    std::promise<void> done;
+    std::future<void> finished = done.get_future();
+    {
+        std::unique_lock<std::mutex> lock(postMutex);
+        if (loopThreadId.load() != std::thread::id()) {
+            posted.push_back([&fn, &done] {
+                fn();
+                done.set_value();
+            });
+            lock.unlock();
+            uint64_t one = 1;
+            ssize_t ret = write(wakeFd, &one, sizeof(one));
+            (void)ret;
+            finished.wait();
+            return;
+        }
+    }
+    // 没有线程在驱动事件循环（尚未启动或已 stop）：先按顺序执行之前投递的任务
+    // （其中可能捕获了即将析构的对象），再在调用线程中执行
+    drainPosted();
+    fn();
+}
+
+bool ClientReactor::inLoopThread() const {
+    return loopThreadId == std::this_thread::get_id();
+}
+
+void ClientReactor::addFd(int fd, uint32_t events, IoHandler* handler) {
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events;
+    ev.data.ptr = handler;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        throw std::runtime_error("epoll_ctl ADD failed.");
+    }
+}
+
+void ClientReactor::modifyFd(int fd, uint32_t events, IoHandler* handler) {
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events;
+    ev.data.ptr = handler;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &ev);
+}
+
+void ClientReactor::removeFd(int fd) {
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+}
+
+void ClientReactor::addTicker(TickHandler* ticker) {
+    tickers.insert(ticker);
+}
+
+void ClientReactor::removeTicker(TickHandler* ticker) {
+    tickers.erase(ticker);
+}
+
+// ==================== CnClient ====================
+
+CnClient::Connection::Connection(CnClient* o, size_t i)
+    : owner(o), index(i), fd(-1), state(DISCONNECTED), outPos(0), wantWrite(false),
+      pendingGrants(0), reconnectDelayMs(o->options.reconnectDelayMs) {}
+
+void CnClient::Connection::onEvents(uint32_t events) {
+    if (state == CONNECTING) {
+        if (events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) {
+            int err = 0;
+            socklen_t len = sizeof(err);
+            getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len);
+            if (err == 0) {
+                owner->onConnected(*this);
+            } else {
+                owner->closeConnection(*this, strerror(err));
+            }
+        }
+        return;
+    }
+    if (events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+        owner->handleReadable(*this);
+    }
+    if (state == CONNECTED && (events & EPOLLOUT)) {
+        owner->handleWritable(*this);
+    }
+}
+
+CnClient::CnClient(ClientReactor& r, const ClientOptions& opts)
+    : reactor(r), options(opts), nextConnection(0), active(false), connectedConnections(0), requestCount(0) {
+    if (options.poolSize == 0) {
+        options.poolSize = 1;
+    }
+    for (size_t i = 0; i < options.poolSize; i++) {
+        connections.emplace_back(new Connection(this, i));
+    }
+    reactor.runSync([this] { reactor.addTicker(this); });
+}
+
+CnClient::~CnClient() {
+    disconnect();
+    reactor.runSync([this] { reactor.removeTicker(this); });
+}
+
+std::future<void> CnClient::connect() {
+    auto waiter = std::make_shared<std::promise<void>>();
+    std::future<void> result = waiter->get_future();
+    reactor.post([this, waiter] {
+        active = true;
+        if (connectedConnections > 0) {
+            waiter->set_value();
+        } else {
+            connectWaiters.push_back(std::move(*waiter));
+            connectDeadline = std::chrono::steady_clock::now() +
+                              std::chrono::milliseconds(options.requestTimeoutMs);
+        }
+        for (auto& conn : connections) {
+            if (conn->state == Connection::DISCONNECTED) {
+                startConnect(*conn);
+            }
+        }
+    });
+    return result;
+}
+
+void CnClient::disconnect() {
+    reactor.runSync([this] {
+        active = false;
+        for (auto& conn : connections) {
+            closeConnection(*conn, "Client disconnected.");
+        }
+        while (!unsent.empty()) {
+            PendingRequest req = std::move(unsent.front());
+            unsent.pop_front();
+            retryOrFail(std::move(req), "Client disconnected.");
+        }
+        for (auto& waiter : connectWaiters) {
+            waiter.set_exception(std::make_exception_ptr(std::runtime_error("Client disconnected.")));
+        }
+        connectWaiters.clear();
+    });
+}
+
+std::future<Packet> CnClient::request(MessageType type, const std::string& data) {
+    // 服务器不回复这些类型：若放进 inFlight，之后的每个响应都会对应到错误的请求上
+    if (type == GRANT_CREDIT || type == STREAM_CHUNK) {
+        std::promise<Packet> rejected;
+        rejected.set_exception(std::make_exception_ptr(
+            std::invalid_argument("Packet type " + std::to_string(type) + " has no response; it cannot be sent as a request.")));
+        return rejected.get_future();
+    }
+    auto req = std::make_shared<PendingRequest>();
+    req->pkt.type = type;
+    req->pkt.data = data;
+    req->attempts = 0;
+    req->expired = false;
+    req->deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(options.requestTimeoutMs);
+    if (options.traceEvery != 0 && requestCount++ % options.traceEvery == 0) {
+        traceStart(req->pkt, TRACE_CLIENT_SEND); // 重试时沿用第一次发送的时间戳
+    }
+    std::future<Packet> result = req->promise.get_future();
+    reactor.post([this, req] { dispatch(std::move(*req)); });
+    return result;
+}
+
+std::future<void> CnClient::sendStreamChunk(int targetId, uint32_t streamId, uint32_t flags,
+                                            const std::string& payload) {
+    auto waiter = std::make_shared<std::promise<void>>();
+    std::future<void> result = waiter->get_future();
+    StreamChunk chunk;
+    chunk.peerId = static_cast<uint32_t>(targetId);
+    chunk.streamId = streamId;
+    chunk.flags = flags;
+    chunk.payload = payload;
+    auto frame = std::make_shared<std::string>(chunk.toPacket().serialize());
+    reactor.post([this, streamId, frame, waiter] {
+        Connection& conn = *connections[streamId % connections.size()];
+        if (!active || conn.state != Connection::CONNECTED) {
+            waiter->set_exception(std::make_exception_ptr(std::runtime_error("Stream connection is not available.")));
+            return;
+        }
+        conn.outBuffer += *frame;
+        conn.streamWaiters.push_back(std::move(*waiter));
+        if (!conn.wantWrite) {
+            handleWritable(conn);
+        }
+    });
+    return result;
+}
+
+void CnClient::onMessage(MessageCallback cb) {
+    reactor.runSync([this, &cb] { messageCallback = std::move(cb); });
+}
+
+void CnClient::onStream(StreamCallback cb) {
+    reactor.runSync([this, &cb] { streamCallback = std::move(cb); });
+}
+
+void CnClient::onConnection(ConnectionCallback cb) {
+    reactor.runSync([this, &cb] { connectionCallback = std::move(cb); });
+}
+
+void CnClient::startConnect(Connection& conn) {
+    conn.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (conn.fd < 0) {
+        closeConnection(conn, "Failed to create socket.");
+        return;
+    }
+    int one = 1;
+    setsockopt(conn.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    struct sockaddr_in serverAddr;
+    memset(&serverAddr, 0, sizeof(serverAddr));
+    serverAddr.sin_family = AF_INET;
+    serverAddr.sin_port = htons(options.port);
+    if (inet_pton(AF_INET, options.host.c_str(), &serverAddr.sin_addr) <= 0) {
+        closeConnection(conn, "Invalid server address.");
+        return;
+    }
+
+    conn.state = Connection::CONNECTING;
+    conn.connectingDeadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(options.connectTimeoutMs);
+    if (::connect(conn.fd, (struct sockaddr*)&serverAddr, sizeof(serverAddr)) == 0) {
+        reactor.addFd(conn.fd, EPOLLIN, &conn);
+        onConnected(conn);
+    } else if (errno == EINPROGRESS) {
+        reactor.addFd(conn.fd, EPOLLOUT, &conn);
+    } else {
+        int err = errno;
+        conn.state = Connection::DISCONNECTED;
+        closeConnection(conn, strerror(err));
+    }
+}
+
+void CnClient::onConnected(Connection& conn) {
+    conn.state = Connection::CONNECTED;
+    conn.reconnectDelayMs = options.reconnectDelayMs;
+    conn.wantWrite = false;
+    reactor.modifyFd(conn.fd, EPOLLIN, &conn);
+    connectedConnections++;
+    LOG(INFO) << "Connection #" << conn.index << " connected to " << options.host << ":" << options.port;
+
+    // 协商压缩和分片：HELLO 是该连接上的第一个请求，其响应也是第一个；在此之前发出的数据包不压缩
+    PendingRequest hello;
+    hello.pkt.type = HELLO;
+    hello.pkt.data = options.compression ? COMPRESSION_CODEC "," PACKET_FEATURE_FRAGMENTS : PACKET_FEATURE_FRAGMENTS;
+    hello.attempts = 0;
+    hello.expired = false;
+    hello.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(options.requestTimeoutMs);
+    sendOn(conn, std::move(hello));
+
+    for (auto& waiter : connectWaiters) {
+        waiter.set_value();
+    }
+    connectWaiters.clear();
+    if (connectionCallback) {
+        connectionCallback(conn.index, true);
+    }
+
+    // 发送断线期间排队的请求
+    while (!unsent.empty() && conn.state == Connection::CONNECTED) {
+        PendingRequest req = std::move(unsent.front());
+        unsent.pop_front();
+        dispatch(std::move(req));
+    }
+}
+
+void CnClient::closeConnection(Connection& conn, const std::string& reason) {
+    bool wasConnected = conn.state == Connection::CONNECTED;
+    if (conn.fd >= 0) {
+        reactor.removeFd(conn.fd);
+        close(conn.fd);
+        conn.fd = -1;
+    }
+    conn.state = Connection::DISCONNECTED;
+    conn.decoder.reset();
+    conn.codec.reset();
+    conn.fragments.reset();
+    conn.outBuffer.clear();
+    conn.outPos = 0;
+    conn.wantWrite = false;
+    conn.pendingGrants = 0;
+    for (auto& waiter : conn.streamWaiters) {
+        waiter.set_exception(std::make_exception_ptr(std::runtime_error("Connection lost: " + reason)));
+    }
+    conn.streamWaiters.clear();
+
+    if (wasConnected) {
+        connectedConnections--;
+        LOG(INFO) << "Connection #" << conn.index << " closed. Reason: " << reason;
+        if (connectionCallback) {
+            connectionCallback(conn.index, false);
+        }
+    }
+    if (active) {
+        conn.reconnectAt = std::chrono::steady_clock::now() + std::chrono::milliseconds(conn.reconnectDelayMs);
+        conn.reconnectDelayMs = std::min(conn.reconnectDelayMs * 2, options.maxReconnectDelayMs);
+    }
+
+    // 未收到响应的请求：重试或以异常结束
+    std::deque<PendingRequest> orphaned;
+    orphaned.swap(conn.inFlight);
+    while (!orphaned.empty()) {
+        PendingRequest req = std::move(orphaned.front());
+        orphaned.pop_front();
+        retryOrFail(std::move(req), "Connection lost: " + reason);
+    }
+}
+
+void CnClient::handleReadable(Connection& conn) {
+    char buffer[READ_CHUNK_SIZE];
+    while (conn.state == Connection::CONNECTED) {
+        ssize_t bytes = recv(conn.fd, buffer, sizeof(buffer), 0);
+        if (bytes > 0) {
+            conn.decoder.append(buffer, bytes);
+            Packet pkt;
+            try {
+                while (conn.state == Connection::CONNECTED && conn.decoder.next(pkt)) {
+                    if (conn.fragments.add(pkt, conn.codec, DEFAULT_MAX_FRAME_SIZE)) {
+                        handlePacket(conn, pkt);
+                    }
+                }
+            } catch (const std::exception& e) {
+                closeConnection(conn, e.what());
+                return;
+            }
+            // 一批数据处理完后合并发送一个信用确认
+            if (conn.state == Connection::CONNECTED && conn.pendingGrants > 0) {
+                Packet grant;
+                grant.type = GRANT_CREDIT;
+                grant.data = std::to_string(conn.pendingGrants);
+                conn.pendingGrants = 0;
+                conn.outBuffer += grant.serialize();
+                if (!conn.wantWrite) {
+                    handleWritable(conn);
+                }
+            }
+        } else if (bytes == 0) {
+            closeConnection(conn, "Server closed connection.");
+            return;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return;
+        } else if (errno != EINTR) {
+            closeConnection(conn, strerror(errno));
+            return;
+        }
+    }
+}
+
+void CnClient::handleWritable(Connection& conn) {
+    while (conn.outPos < conn.outBuffer.size()) {
+        ssize_t sent = send(conn.fd, conn.outBuffer.data() + conn.outPos,
+                            conn.outBuffer.size() - conn.outPos, MSG_NOSIGNAL);
+        if (sent > 0) {
+            conn.outPos += sent;
+        } else if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        } else if (sent < 0 && errno == EINTR) {
+            continue;
+        } else {
+            closeConnection(conn, "Failed to send data.");
+            return;
+        }
+    }
+    if (conn.outPos == conn.outBuffer.size()) {
+        conn.outBuffer.clear();
+        conn.outPos = 0;
+    }
+    if (!conn.streamWaiters.empty() && conn.outBuffer.size() - conn.outPos < STREAM_SEND_WINDOW) {
+        for (auto& waiter : conn.streamWaiters) {
+            waiter.set_value();
+        }
+        conn.streamWaiters.clear();
+    }
+    updateInterest(conn);
+}
+
+void CnClient::updateInterest(Connection& conn) {
+    bool needWrite = conn.outPos < conn.outBuffer.size();
+    if (needWrite != conn.wantWrite) {
+        conn.wantWrite = needWrite;
+        reactor.modifyFd(conn.fd, needWrite ? (EPOLLIN | EPOLLOUT) : EPOLLIN, &conn);
+    }
+}
+
+void CnClient::handlePacket(Connection& conn, Packet& pkt) {
+    // 服务器对每个连接按顺序处理请求，因此响应与 inFlight 的队首一一对应
+    if ((pkt.type == RESPONSE || pkt.type == CLIENT_LIST || pkt.type == BACKPRESSURE) && !conn.inFlight.empty()) {
+        PendingRequest req = std::move(conn.inFlight.front());
+        conn.inFlight.pop_front();
+        if (req.pkt.type == HELLO && pkt.type == RESPONSE && helloAccepted(pkt.data, COMPRESSION_CODEC)) {
+            conn.codec.enable(options.compressMinBytes);
+        }
+        if (pkt.flags & PACKET_FLAG_TRACE) {
+            traceStamp(pkt, TRACE_CLIENT_RECV);
+            traceStats.record(tracePath(req.pkt.type), pkt.trace);
+        }
+        if (!req.expired) {
+            req.promise.set_value(std::move(pkt));
+        }
+        return;
+    }
+    StreamChunk chunk;
+    if (pkt.type == STREAM_CHUNK && streamCallback && StreamChunk::parse(pkt.data, chunk)) {
+        streamCallback(chunk);
+        return;
+    }
+    if (pkt.type == SEND_MESSAGE && (pkt.flags & PACKET_FLAG_TRACE)) {
+        traceStamp(pkt, TRACE_CLIENT_DELIVER);
+        traceStats.record("forward", pkt.trace);
+    }
+    if (messageCallback) {
+        messageCallback(pkt);
+    }
+    if (pkt.type == SEND_MESSAGE && options.autoGrantCredit) {
+        conn.pendingGrants++;
+    }
+}
+
+void CnClient::dispatch(PendingRequest&& req) {
+    if (!active) {
+        req.promise.set_exception(std::make_exception_ptr(std::runtime_error("Client is not connected.")));
+        return;
+    }
+    Connection* conn = pickConnection();
+    if (conn == nullptr) {
+        unsent.push_back(std::move(req));
+        return;
+    }
+    sendOn(*conn, std::move(req));
+}
+
+void CnClient::sendOn(Connection& conn, PendingRequest&& req) {
+    // 按连接压缩（req.pkt 保持原样，重试时可能发往未协商压缩的连接）：
+    // SEND_MESSAGE 用共享字典压缩，服务器可以不解压直接转发；其他请求用连接上的流式上下文
+    Packet encoded;
+    bool changed = false;
+    if (conn.codec.enabled() && req.pkt.type == SEND_MESSAGE) {
+        encoded = req.pkt;
+        changed = PacketCodec::compressRelayable(encoded, options.compressMinBytes);
+    } else {
+        changed = conn.codec.encode(req.pkt, encoded);
+    }
+    conn.outBuffer += changed ? encoded.serialize() : req.pkt.serialize();
+    req.attempts++;
+    conn.inFlight.push_back(std::move(req));
+    if (!conn.wantWrite) {
+        handleWritable(conn);
+    }
+}
+
+void CnClient::retryOrFail(PendingRequest&& req, const std::string& reason) {
+    if (req.expired) {
+        return; // 已经以超时结束
+    }
+    if (active && req.attempts <= options.maxRetries && isRetryable(req)) {
+        dispatch(std::move(req));
+        return;
+    }
+    req.promise.set_exception(std::make_exception_ptr(std::runtime_error(reason)));
+}
+
+CnClient::Connection* CnClient::pickConnection() {
+    for (size_t i = 0; i < connections.size(); i++) {
+        Connection& conn = *connections[(nextConnection + i) % connections.size()];
+        if (conn.state == Connection::CONNECTED) {
+            nextConnection = (conn.index + 1) % connections.size();
+            return &conn;
+        }
+    }
+    return nullptr;
+}
+
+bool CnClient::isRetryable(const PendingRequest& req) const {
+    switch (req.pkt.type) {
+        case GET_TIME:
+        case GET_NAME:
+        case LIST_CLIENTS:
+            return true;
+        case DISCONNECT:
+        case HELLO:
+            return false;
+        default:
+            return options.retryNonIdempotent;
+    }
+}
+
+void CnClient::onTick(std::chrono::steady_clock::time_point now) {
+    if (!active) {
+        return;
+    }
+    for (auto& conn : connections) {
+        if (conn->state == Connection::DISCONNECTED && now >= conn->reconnectAt) {
+            startConnect(*conn);
+        } else if (conn->state == Connection::CONNECTING && options.connectTimeoutMs > 0 &&
+                   now >= conn->connectingDeadline) {
+            // SYN 被丢弃时 connect 可能数分钟都不返回，按退避重新发起
+            LOG(WARNING) << "Connection #" << conn->index << " connect timed out.";
+            closeConnection(*conn, "Connect timed out.");
+        }
+    }
+    if (options.requestTimeoutMs <= 0) {
+        return;
+    }
+    std::exception_ptr timeout = std::make_exception_ptr(std::runtime_error("Request timed out."));
+    for (auto& conn : connections) {
+        for (auto& req : conn->inFlight) {
+            if (!req.expired && now >= req.deadline) {
+                req.expired = true;
+                req.promise.set_exception(timeout);
+            }
+        }
+    }
+    while (!unsent.empty() && now >= unsent.front().deadline) {
+        unsent.front().promise.set_exception(timeout);
+        unsent.pop_front();
+    }
+    if (!connectWaiters.empty() && now >= connectDeadline) {
+        for (auto& waiter : connectWaiters) {
+            waiter.set_exception(std::make_exception_ptr(std::runtime_error("Connect timed out.")));
+        }
+        connectWaiters.clear();
+    }
+}
@@ -0,0 +1,218 @@
+// CnClient.h
+// 可嵌入的异步客户端库（libcn_client）
+//
+// - ClientReactor：一个 epoll 线程，驱动任意多个 CnClient（逻辑会话）
+// - CnClient：到服务器的一组连接（连接池），请求按轮询分配到已连接的连接上，
+//   断线后自动重连，并对可重试的请求重新发送
+// - 所有公开方法都是线程安全的；回调在 reactor 线程中执行，不应阻塞
+#ifndef CNCLIENT_H
+#define CNCLIENT_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include "Message/MySocket.h"
+#include "Message/FrameDecoder.h"
+#include "Message/StreamChunk.h"
+#include "Message/Compression.h"
+#include "Message/Fragment.h"
+#include "Message/Trace.h"
+
+#define STREAM_SEND_WINDOW (1 << 20) // 连接发送缓冲区超过该值时 sendStreamChunk 的 future 延后完成
+
+// epoll 事件处理接口
+class IoHandler {
+public:
+    virtual ~IoHandler() {}
+    virtual void onEvents(uint32_t events) = 0;
+};
+
+// 需要周期性检查超时/重连的对象
+class TickHandler {
+public:
+    virtual ~TickHandler() {}
+    virtual void onTick(std::chrono::steady_clock::time_point now) = 0;
+};
+
+class ClientReactor {
+private:
+    int epollFd;
+    int wakeFd;
+    std::atomic<bool> running;
+    std::thread loopThread;
+    // 驱动事件循环的线程，首次 run()/poll() 时绑定；默认值表示没有线程在驱动
+    std::atomic<std::thread::id> loopThreadId;
+
+    std::mutex postMutex;
+    std::vector<std::function<void()>> posted;
+    std::unordered_set<TickHandler*> tickers;
+
+    void drainPosted();
+    void bindLoopThread(std::thread::id id);
+
+public:
+    ClientReactor();
+    ~ClientReactor();
+
+    ClientReactor(const ClientReactor&) = delete;
+    ClientReactor& operator=(const ClientReactor&) = delete;
+
+    // 在内部线程中运行事件循环
+    void startThread();
+    // 在调用线程中运行事件循环，直到 stop()；返回后其他线程的 runSync 改为在调用线程中执行
+    void run();
+    // 执行一次事件循环迭代（用于嵌入调用方自己的循环），返回处理的事件数。
+    // 首次调用把 reactor 永久绑定到调用线程，之后只能由该线程驱动
+    int poll(int timeoutMs);
+    void stop();
+
+    // 将任务投递到 reactor 线程执行
+    void post(std::function<void()> fn);
+    // 在 reactor 线程中执行并等待完成（若已在 reactor 线程中则直接执行；
+    // 没有线程在驱动时先执行已投递的任务，再在调用线程中执行）
+    void runSync(const std::function<void()>& fn);
+    bool inLoopThread() const;
+
+    // 以下仅可在 reactor 线程中调用
+    void addFd(int fd, uint32_t events, IoHandler* handler);
+    void modifyFd(int fd, uint32_t events, IoHandler* handler);
+    void removeFd(int fd);
+    void addTicker(TickHandler* ticker);
+    void removeTicker(TickHandler* ticker);
+};
+
+struct ClientOptions {
+    std::string host = "127.0.0.1";
+    uint16_t port = 5869;
+    size_t poolSize = 1;                 // 连接池大小
+    int reconnectDelayMs = 200;          // 首次重连延迟，之后指数退避
+    int maxReconnectDelayMs = 5000;      // 重连延迟上限
+    int connectTimeoutMs = 3000;         // 单次连接尝试的超时，超时后按退避重连（0 表示不超时）
+    int requestTimeoutMs = 5000;         // 请求超时（0 表示不超时）
+    int maxRetries = 2;                  // 连接断开后请求的最大重试次数
+    bool retryNonIdempotent = false;     // 是否重试 SEND_MESSAGE 等非幂等请求
+    bool autoGrantCredit = true;         // 消息回调返回后自动向服务器归还转发信用
+    bool compression = true;             // 连接建立后协商压缩（服务器不支持时照常不压缩）
+    size_t compressMinBytes = COMPRESS_MIN_BYTES; // 不少于该字节数的数据才压缩
+    uint32_t traceEvery = 0;             // 每 N 个请求追踪一次分阶段延迟（0 表示关闭），见 traceReport()
+};
+
+class CnClient : private TickHandler {
+public:
+    typedef std::function<void(const Packet&)> MessageCallback;
+    typedef std::function<void(size_t index, bool connected)> ConnectionCallback;
+    typedef std::function<void(const StreamChunk&)> StreamCallback;
+
+    CnClient(ClientReactor& reactor, const ClientOptions& options);
+    ~CnClient();
+
+    CnClient(const CnClient&) = delete;
+    CnClient& operator=(const CnClient&) = delete;
+
+    // 建立连接池中的所有连接；至少一个连接建立成功时 future 完成
+    std::future<void> connect();
+    // 关闭所有连接并停止重连，未完成的请求以异常结束
+    void disconnect();
+
+    // 发送请求，future 在收到对应响应（RESPONSE / CLIENT_LIST / BACKPRESSURE）时完成。
+    // 服务器不回复的类型（GRANT_CREDIT、STREAM_CHUNK）不能作为请求发送，future 直接以 invalid_argument 结束
+    std::future<Packet> request(MessageType type, const std::string& data = "");
+    std::future<Packet> getTime() { return request(GET_TIME); }
+    std::future<Packet> getName() { return request(GET_NAME); }
+    std::future<Packet> listClients() { return request(LIST_CLIENTS); }
+    std::future<Packet> sendMessage(int targetId, const std::string& message) {
+        return request(SEND_MESSAGE, std::to_string(targetId) + ":" + message);
+    }
+
+    // 发送一个流分块（STREAM_CHUNK，服务器不回复）。同一 streamId 的分块固定走同一个连接以保证顺序；
+    // future 在分块进入发送缓冲区、且缓冲区低于 STREAM_SEND_WINDOW 时完成，调用方等待它即可控制发送速度
+    std::future<void> sendStreamChunk(int targetId, uint32_t streamId, uint32_t flags, const std::string& payload);
+
+    // 服务器主动推送的数据包（转发的消息、服务器关闭通知）
+    void onMessage(MessageCallback cb);
+    // 收到的流分块（未设置时交给 onMessage 回调）
+    void onStream(StreamCallback cb);
+    // 连接状态变化
+    void onConnection(ConnectionCallback cb);
+
+    size_t connectedCount() const { return connectedConnections.load(); }
+
+    // 被追踪的响应（按请求类型）和收到的转发消息（"forward"）的分阶段延迟
+    std::string traceReport() const { return traceStats.describe(); }
+    void resetTraceStats() { traceStats.clear(); }
+
+private:
+    struct PendingRequest {
+        Packet pkt;
+        std::promise<Packet> promise;
+        int attempts;
+        std::chrono::steady_clock::time_point deadline;
+        bool expired; // 已超时：保留在队列中以消费迟到的响应
+    };
+
+    struct Connection : public IoHandler {
+        enum State { DISCONNECTED, CONNECTING, CONNECTED };
+
+        CnClient* owner;
+        size_t index;
+        int fd;
+        State state;
+        FrameDecoder decoder;
+        PacketCodec codec;                   // 本连接的压缩上下文（每次重连重新开始）
+        FragmentAssembler fragments;         // 服务器分片发送的大数据包
+        std::string outBuffer;
+        size_t outPos;
+        bool wantWrite;
+        std::deque<PendingRequest> inFlight; // 按发送顺序等待响应
+        uint32_t pendingGrants;              // 已处理、尚未确认的转发消息数
+        std::vector<std::promise<void>> streamWaiters; // 等待发送缓冲区低于 STREAM_SEND_WINDOW 的流分块
+        int reconnectDelayMs;
+        std::chrono::steady_clock::time_point reconnectAt;
+        std::chrono::steady_clock::time_point connectingDeadline; // CONNECTING 状态的截止时间
+
+        Connection(CnClient* o, size_t i);
+        void onEvents(uint32_t events) override;
+    };
+
+    ClientReactor& reactor;
+    ClientOptions options;
+    std::vector<std::unique_ptr<Connection>> connections;
+    std::deque<PendingRequest> unsent; // 暂无可用连接时排队的请求
+    size_t nextConnection;
+    bool active;
+    std::atomic<size_t> connectedConnections;
+    std::vector<std::promise<void>> connectWaiters;
+    std::chrono::steady_clock::time_point connectDeadline;
+    MessageCallback messageCallback;
+    ConnectionCallback connectionCallback;
+    StreamCallback streamCallback;
+    std::atomic<uint64_t> requestCount; // 按 traceEvery 采样
+    TraceStats traceStats;
+
+    void onTick(std::chrono::steady_clock::time_point now) override;
+
+    void startConnect(Connection& conn);
+    void onConnected(Connection& conn);
+    void closeConnection(Connection& conn, const std::string& reason);
+    void handleReadable(Connection& conn);
+    void handleWritable(Connection& conn);
+    void handlePacket(Connection& conn, Packet& pkt);
+    void updateInterest(Connection& conn);
+
+    void dispatch(PendingRequest&& req);
+    void sendOn(Connection& conn, PendingRequest&& req);
+    void retryOrFail(PendingRequest&& req, const std::string& reason);
+    Connection* pickConnection();
+    bool isRetryable(const PendingRequest& req) const;
+};
+
+#endif // CNCLIENT_H
@@ -0,0 +1,81 @@
+// Capture.h
+// 流量抓包文件格式（服务器 --capture 写入，replay 工具读取）
+//
+// 文件头：魔数 "CNCAP001"(8) + 抓包开始时的墙上时间（微秒，8）
+// 记录：[种类(1)][客户端ID(4)][相对抓包开始的时间（纳秒，8）][类型字段(4)][数据长度(4)][数据]
+// - CAPTURE_OPEN：客户端连接建立，数据为 "IP:Port"
+// - CAPTURE_FRAME：收到的一个数据包（已解开流式压缩，即处理函数看到的内容），类型字段含标志位
+// - CAPTURE_DONE：服务器处理完该连接上最早一个未完成的数据包（含发送响应），无数据
+// - CAPTURE_CLOSE：连接关闭，无数据
+// 整数均为大端序
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <arpa/inet.h>
+#include "MySocket.h"
+
+#define CAPTURE_MAGIC "CNCAP001"
+#define CAPTURE_FILE_HEADER_SIZE 16
+#define CAPTURE_RECORD_HEADER_SIZE 21
+
+enum CaptureKind : uint8_t {
+    CAPTURE_OPEN = 1,
+    CAPTURE_FRAME = 2,
+    CAPTURE_DONE = 3,
+    CAPTURE_CLOSE = 4
+};
+
+struct CaptureRecord {
+    CaptureKind kind = CAPTURE_FRAME;
+    uint32_t clientId = 0;
+    uint64_t timestampNs = 0;
+    uint32_t type = 0; // 含 PACKET_FLAG_* 的原始类型字段
+    std::string data;
+
+    void appendTo(std::string& out) const {
+        char header[CAPTURE_RECORD_HEADER_SIZE];
+        header[0] = static_cast<char>(kind);
+        writeU32(header + 1, clientId);
+        writeU32(header + 5, static_cast<uint32_t>(timestampNs >> 32));
+        writeU32(header + 9, static_cast<uint32_t>(timestampNs));
+        writeU32(header + 13, type);
+        writeU32(header + 17, static_cast<uint32_t>(data.size()));
+        out.append(header, sizeof(header));
+        out.append(data);
+    }
+
+    // 从 buffer 的 pos 处解析一条记录并前移 pos；剩余数据不足一条记录时返回 false
+    static bool parse(const std::string& buffer, size_t& pos, CaptureRecord& out) {
+        if (buffer.size() - pos < CAPTURE_RECORD_HEADER_SIZE) {
+            return false;
+        }
+        const char* header = buffer.data() + pos;
+        uint32_t length = readU32(header + 17);
+        if (buffer.size() - pos - CAPTURE_RECORD_HEADER_SIZE < length) {
+            return false;
+        }
+        out.kind = static_cast<CaptureKind>(header[0]);
+        out.clientId = readU32(header + 1);
+        out.timestampNs = (static_cast<uint64_t>(readU32(header + 5)) << 32) | readU32(header + 9);
+        out.type = readU32(header + 13);
+        out.data.assign(buffer, pos + CAPTURE_RECORD_HEADER_SIZE, length);
+        pos += CAPTURE_RECORD_HEADER_SIZE + length;
+        return true;
+    }
+
+    static void writeU32(char* out, uint32_t value) {
+        uint32_t netValue = htonl(value);
+        memcpy(out, &netValue, sizeof(netValue));
+    }
+    static uint32_t readU32(const char* in) {
+        uint32_t value;
+        memcpy(&value, in, sizeof(value));
+        return ntohl(value);
+    }
+};
+
+#endif // CAPTURE_H
@@ -0,0 +1,262 @@
+// Compression.h
+// 按连接协商的数据包压缩（zlib raw deflate）
+//
+// - 连接建立后客户端发送 HELLO（支持的编码），服务器回复选中的编码；之后双方才会发送压缩的数据包
+// - PACKET_FLAG_ZSTREAM：用连接上的流式上下文压缩，每个数据包以 Z_SYNC_FLUSH 结束，
+//   后续数据包可以引用之前的内容（重复的聊天内容、客户端列表压缩率很高）；只有该连接的对端能解开
+// - PACKET_FLAG_ZDICT：用共享字典独立压缩，不依赖连接状态，整个数据部分都是压缩的；唯一的例外是
+//   客户端发出的 SEND_MESSAGE，只压缩 "targetId:" 之后的消息，服务器无需解压即可把它原样转发给
+//   协商了同一编码的接收方（未协商的接收方由服务器解压后发送）
+// - 只压缩不少于阈值的数据；STREAM_CHUNK 不压缩（服务器要读取分块头部并可能 splice 转发）
+// - 同步刷新产生的结尾 00 00 FF FF 不发送，解压时补上
+// - 追踪时间戳（PACKET_FLAG_TRACE）在数据之外，不压缩，原样保留
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <zlib.h>
+#include "MySocket.h"
+
+#define COMPRESSION_CODEC "zlib-d1"  // 编码名：zlib raw deflate + 第 1 版共享字典
+#define COMPRESS_MIN_BYTES 64        // 默认压缩阈值
+#define COMPRESS_LEVEL 6
+#define COMPRESS_WINDOW_BITS 12      // 4KB 窗口：每个连接的压缩上下文约 40KB
+#define COMPRESS_MEM_LEVEL 5
+
+// 共享字典：从聊天记录和客户端列表样本中统计出的高频片段，越常见的越靠后（离数据越近，引用距离越短）。
+// 修改内容必须同时修改 COMPRESSION_CODEC，否则新旧版本之间会解出错误的数据
+static const char COMPRESSION_DICTIONARY[] =
+    "Server shutting down.Disconnected successfully.Unknown command.Zimo Server"
+    "Invalid message format. Use targetId:message.Target client ID not found."
+    "Receiver is not keeping up. Message rejected, retry later."
+    "Message queued for client  (waiting for receiver credit).Message sent to client "
+    "thanks, thank you, please, sorry, tomorrow, today, tonight, meeting, server, client, "
+    "message, file, send, received, check, working, done, okay, sure, what, when, where, "
+    "how are you? I am fine. see you later. good morning, good night, "
+    "谢谢，好的，没问题，收到，明天，今天，晚上，会议，服务器，客户端，消息，文件，发送，"
+    "你好，在吗？我在。稍等一下。好的，谢谢！"
+    "hello, hi, yes, no, the, and, that, this, have, with, for, you, 的了是我你在吗"
+    "ID 1: 127.0.0.1:5 (node 1)\nID 2: 127.0.0.1:4 (node 2)\nID 3: 192.168.1.1:5 (node 3)\n"
+    "ID 1000001: 127.0.0.1:ID 2000001: 127.0.0.1:ID ";
+
+class PacketCodec {
+public:
+    PacketCodec() : minBytes(0), sendEnabled(false), deflateReady(false), inflateReady(false) {}
+
+    ~PacketCodec() {
+        if (deflateReady) {
+            deflateEnd(&deflater);
+        }
+        if (inflateReady) {
+            inflateEnd(&inflater);
+        }
+    }
+
+    PacketCodec(const PacketCodec&) = delete;
+    PacketCodec& operator=(const PacketCodec&) = delete;
+
+    // 协商成功后开启发送方向的压缩，数据不少于 threshold 字节时压缩
+    void enable(size_t threshold) {
+        minBytes = threshold;
+        sendEnabled = true;
+    }
+    bool enabled() const { return sendEnabled; }
+
+    // 连接断开重连后，流式上下文必须重新开始
+    void reset() {
+        sendEnabled = false;
+        if (deflateReady) {
+            deflateEnd(&deflater);
+            deflateReady = false;
+        }
+        if (inflateReady) {
+            inflateEnd(&inflater);
+            inflateReady = false;
+        }
+    }
+
+    // 发送前调用：需要改变数据时把结果写入 out 并返回 true，否则原样发送 pkt。
+    // 未压缩的大数据包用流式上下文压缩；带 PACKET_FLAG_ZDICT 的包在对端未协商压缩时先解开，
+    // 解开后超过 maxSize（本连接的帧上限）时抛出异常
+    bool encode(const Packet& pkt, Packet& out, size_t maxSize = DEFAULT_MAX_FRAME_SIZE) {
+        if (pkt.flags & PACKET_FLAG_ZDICT) {
+            if (sendEnabled) {
+                return false;
+            }
+            out.type = pkt.type;
+            out.flags = pkt.flags & ~PACKET_FLAG_ZDICT;
+            out.trace = pkt.trace;
+            decompressRelayable(pkt, out.data, maxSize);
+            return true;
+        }
+        if (!sendEnabled || (pkt.flags & ~PACKET_FLAG_TRACE) != 0 || pkt.type == STREAM_CHUNK ||
+            pkt.data.size() < minBytes) {
+            return false;
+        }
+        if (!deflateReady) {
+            initDeflate(deflater);
+            deflateReady = true;
+        }
+        out.type = pkt.type;
+        out.flags = PACKET_FLAG_ZSTREAM | (pkt.flags & PACKET_FLAG_TRACE);
+        out.trace = pkt.trace;
+        deflateData(deflater, pkt.data.data(), pkt.data.size(), out.data);
+        return true;
+    }
+
+    // 收到后调用：解开流式压缩；keepDictionary 为 true 时保留共享字典压缩的数据（服务器收到的 SEND_MESSAGE，用于原样转发）。
+    // 解压后超过 maxSize 或数据损坏时抛出异常
+    void decode(Packet& pkt, size_t maxSize, bool keepDictionary = false) {
+        if (pkt.flags & PACKET_FLAG_ZSTREAM) {
+            if (!inflateReady) {
+                initInflate(inflater);
+                inflateReady = true;
+            }
+            std::string plain;
+            inflateData(inflater, pkt.data.data(), pkt.data.size(), plain, maxSize);
+            pkt.data.swap(plain);
+            pkt.flags &= ~PACKET_FLAG_ZSTREAM;
+        } else if ((pkt.flags & PACKET_FLAG_ZDICT) && !keepDictionary) {
+            std::string plain;
+            decompressRelayable(pkt, plain, maxSize);
+            pkt.data.swap(plain);
+            pkt.flags &= ~PACKET_FLAG_ZDICT;
+        }
+    }
+
+    // 用共享字典压缩可转发的数据包（SEND_MESSAGE 只压缩 "targetId:" 之后的部分）；
+    // 数据太短或压缩后没有变小时不做改变，返回 false
+    static bool compressRelayable(Packet& pkt, size_t threshold) {
+        if ((pkt.flags & ~PACKET_FLAG_TRACE) != 0) {
+            return false;
+        }
+        size_t start = 0;
+        if (pkt.type == SEND_MESSAGE) {
+            start = pkt.data.find(':');
+            if (start == std::string::npos) {
+                return false;
+            }
+            start++;
+        }
+        if (pkt.data.size() - start < threshold) {
+            return false;
+        }
+        DictionaryStreams& streams = dictionaryStreams();
+        deflateReset(&streams.deflater);
+        deflateSetDictionary(&streams.deflater, reinterpret_cast<const Bytef*>(COMPRESSION_DICTIONARY),
+                             sizeof(COMPRESSION_DICTIONARY) - 1);
+        std::string compressed;
+        deflateData(streams.deflater, pkt.data.data() + start, pkt.data.size() - start, compressed);
+        if (compressed.size() >= pkt.data.size() - start) {
+            return false;
+        }
+        pkt.data.replace(start, std::string::npos, compressed);
+        pkt.flags |= PACKET_FLAG_ZDICT;
+        return true;
+    }
+
+    // 解开共享字典压缩的数据（整个数据部分都是压缩的）
+    static void decompressRelayable(const Packet& pkt, std::string& out, size_t maxSize) {
+        DictionaryStreams& streams = dictionaryStreams();
+        inflateReset(&streams.inflater);
+        inflateSetDictionary(&streams.inflater, reinterpret_cast<const Bytef*>(COMPRESSION_DICTIONARY),
+                             sizeof(COMPRESSION_DICTIONARY) - 1);
+        inflateData(streams.inflater, pkt.data.data(), pkt.data.size(), out, maxSize);
+    }
+
+private:
+    size_t minBytes;
+    bool sendEnabled;
+    bool deflateReady;
+    bool inflateReady;
+    z_stream deflater; // 发送方向的流式上下文
+    z_stream inflater; // 接收方向的流式上下文
+
+    // 共享字典压缩不依赖连接，每个线程复用一对上下文（每次使用前重置），避免每条消息分配窗口
+    struct DictionaryStreams {
+        z_stream deflater;
+        z_stream inflater;
+        DictionaryStreams() {
+            initDeflate(deflater);
+            initInflate(inflater);
+        }
+        ~DictionaryStreams() {
+            deflateEnd(&deflater);
+            inflateEnd(&inflater);
+        }
+    };
+    static DictionaryStreams& dictionaryStreams() {
+        static thread_local DictionaryStreams streams;
+        return streams;
+    }
+
+    static void initDeflate(z_stream& zs) {
+        memset(&zs, 0, sizeof(zs));
+        if (deflateInit2(&zs, COMPRESS_LEVEL, Z_DEFLATED, -COMPRESS_WINDOW_BITS, COMPRESS_MEM_LEVEL,
+                         Z_DEFAULT_STRATEGY) != Z_OK) {
+            throw std::runtime_error("Failed to initialize compressor.");
+        }
+    }
+
+    static void initInflate(z_stream& zs) {
+        memset(&zs, 0, sizeof(zs));
+        if (inflateInit2(&zs, -COMPRESS_WINDOW_BITS) != Z_OK) {
+            throw std::runtime_error("Failed to initialize decompressor.");
+        }
+    }
+
+    // 压缩并同步刷新，去掉结尾的 00 00 FF FF
+    static void deflateData(z_stream& zs, const char* data, size_t len, std::string& out) {
+        out.resize(deflateBound(&zs, len) + 16);
+        zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+        zs.avail_in = static_cast<uInt>(len);
+        size_t produced = 0;
+        do {
+            if (produced == out.size()) {
+                out.resize(out.size() * 2);
+            }
+            zs.next_out = reinterpret_cast<Bytef*>(&out[produced]);
+            zs.avail_out = static_cast<uInt>(out.size() - produced);
+            if (deflate(&zs, Z_SYNC_FLUSH) == Z_STREAM_ERROR) {
+                throw std::runtime_error("Compression failed.");
+            }
+            produced = out.size() - zs.avail_out;
+        } while (zs.avail_out == 0);
+        out.resize(produced >= 4 ? produced - 4 : produced);
+    }
+
+    static void inflateData(z_stream& zs, const char* data, size_t len, std::string& out, size_t maxSize) {
+        static const char syncTail[4] = {0, 0, static_cast<char>(0xff), static_cast<char>(0xff)};
+        out.clear();
+        inflatePiece(zs, data, len, out, maxSize);
+        inflatePiece(zs, syncTail, sizeof(syncTail), out, maxSize);
+    }
+
+    static void inflatePiece(z_stream& zs, const char* data, size_t len, std::string& out, size_t maxSize) {
+        zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+        zs.avail_in = static_cast<uInt>(len);
+        do {
+            size_t produced = out.size();
+            out.resize(produced + std::max<size_t>(len * 4, 1024));
+            zs.next_out = reinterpret_cast<Bytef*>(&out[produced]);
+            zs.avail_out = static_cast<uInt>(out.size() - produced);
+            int ret = inflate(&zs, Z_SYNC_FLUSH);
+            out.resize(out.size() - zs.avail_out);
+            if (ret != Z_OK && ret != Z_BUF_ERROR) {
+                throw std::runtime_error("Corrupted compressed packet.");
+            }
+            if (out.size() > maxSize) {
+                throw std::runtime_error("Decompressed packet too large.");
+            }
+            if (ret == Z_BUF_ERROR) {
+                break; // 没有可继续处理的输入
+            }
+        } while (zs.avail_in > 0 || zs.avail_out == 0);
+    }
+};
+
+#endif // COMPRESSION_H
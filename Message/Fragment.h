@@ -0,0 +1,84 @@
+// Fragment.h
+// 服务器发往客户端的大数据包分片
+//
+// - 服务器的发送队列分为控制、请求/响应、批量三个车道，按权重轮流发送（见 Server/Connection.h）。
+//   协商了 PACKET_FEATURE_FRAGMENTS 的连接上，批量车道中超过 FRAGMENT_BYTES 的数据包被拆成多个分片，
+//   分片之间可以插入其他车道的数据包，小的响应不必等整个大消息发完
+// - 分片与原数据包类型相同；除最后一个外都带 PACKET_FLAG_MORE，最后一个带 PACKET_FLAG_LAST。
+//   同一连接上同一时刻最多只有一个未完成的分片序列
+// - 每个分片单独做流式压缩（与其他数据包共用连接的压缩上下文，按发送顺序），收到后立即解开；
+//   共享字典压缩的数据包的每个分片都带 PACKET_FLAG_ZDICT，拼接完整后才解开
+#ifndef FRAGMENT_H
+#define FRAGMENT_H
+
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include "MySocket.h"
+#include "Compression.h"
+
+#define PACKET_FEATURE_FRAGMENTS "frag" // HELLO 中表示能够重组分片
+#define FRAGMENT_BYTES (16 << 10)       // 每个分片的数据大小
+
+// HELLO 响应（逗号分隔）中是否包含 feature
+inline bool helloAccepted(const std::string& response, const std::string& feature) {
+    std::stringstream accepted(response);
+    std::string item;
+    while (std::getline(accepted, item, ',')) {
+        if (item == feature) {
+            return true;
+        }
+    }
+    return false;
+}
+
+class FragmentAssembler {
+public:
+    FragmentAssembler() : active(false), type(RESPONSE) {}
+
+    // 每个收到的数据包都交给 add（代替直接调用 codec.decode）：返回 true 时 pkt 是解压后的完整数据包；
+    // 返回 false 表示 pkt 是未完成的分片，已被取走。分片交错或重组后超过 maxSize 时抛出异常
+    bool add(Packet& pkt, PacketCodec& codec, size_t maxSize) {
+        uint32_t fragment = pkt.flags & (PACKET_FLAG_MORE | PACKET_FLAG_LAST);
+        if (fragment == 0) {
+            codec.decode(pkt, maxSize);
+            return true;
+        }
+        pkt.flags &= ~(PACKET_FLAG_MORE | PACKET_FLAG_LAST);
+        if (pkt.flags & PACKET_FLAG_ZSTREAM) {
+            codec.decode(pkt, maxSize);
+        }
+        if (!active) {
+            active = true;
+            type = pkt.type;
+            buffer.clear();
+        } else if (pkt.type != type) {
+            throw std::runtime_error("Interleaved packet fragments.");
+        }
+        if (buffer.size() + pkt.data.size() > maxSize) {
+            throw std::runtime_error("Reassembled packet too large.");
+        }
+        buffer.append(pkt.data);
+        if (fragment & PACKET_FLAG_MORE) {
+            return false;
+        }
+        active = false;
+        pkt.data.swap(buffer);
+        buffer.clear();
+        codec.decode(pkt, maxSize); // 共享字典压缩
+        return true;
+    }
+
+    // 连接断开时丢弃未完成的数据包
+    void reset() {
+        active = false;
+        buffer.clear();
+    }
+
+private:
+    bool active;
+    MessageType type;
+    std::string buffer;
+};
+
+#endif // FRAGMENT_H
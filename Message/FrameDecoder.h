@@ -0,0 +1,96 @@
+// FrameDecoder.h
+#ifndef FRAMEDECODER_H
+#define FRAMEDECODER_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <stdexcept>
+#include <arpa/inet.h>
+#include "MySocket.h"
+
+// 非阻塞 socket 的增量解帧器：按任意大小追加收到的字节，逐个取出完整的 Packet
+// 帧格式与 Packet::serialize 一致：[总长度(4)][类型(4)][数据]
+class FrameDecoder {
+private:
+    std::string buffer;
+    size_t readPos;
+    size_t maxDataSize; // 单帧数据部分上限，超过时在分配内存之前报错
+
+    void compact() {
+        // 已消费的前缀超过一半时才搬移，避免每帧都 memmove
+        if (readPos > 0 && readPos * 2 >= buffer.size()) {
+            buffer.erase(0, readPos);
+            readPos = 0;
+        }
+    }
+
+public:
+    explicit FrameDecoder(size_t maxData = DEFAULT_MAX_FRAME_SIZE) : readPos(0), maxDataSize(maxData) {}
+
+    void setMaxFrameSize(size_t maxData) {
+        maxDataSize = maxData;
+    }
+
+    void append(const char* data, size_t len) {
+        buffer.append(data, len);
+    }
+
+    // 查看下一帧的头部（总长度、类型）而不取出；头部不完整时返回 false，帧长度非法时抛出异常
+    bool peekHeader(uint32_t& length, uint32_t& type) const {
+        if (buffer.size() - readPos < 8) {
+            return false;
+        }
+        uint32_t netLength;
+        uint32_t netType;
+        memcpy(&netLength, buffer.data() + readPos, sizeof(netLength));
+        memcpy(&netType, buffer.data() + readPos + 4, sizeof(netType));
+        length = ntohl(netLength);
+        type = ntohl(netType);
+        if (length < 8) {
+            throw std::runtime_error("Invalid packet length.");
+        }
+        if (length - 8 > maxDataSize) {
+            throw std::runtime_error("Packet too large: " + std::to_string(length - 8) + " bytes.");
+        }
+        return true;
+    }
+
+    // 尝试取出一个完整数据包；数据不足时返回 false，帧长度非法时抛出异常
+    bool next(Packet& out) {
+        uint32_t length;
+        uint32_t type;
+        if (!peekHeader(length, type) || buffer.size() - readPos < length) {
+            compact();
+            return false;
+        }
+        out.type = static_cast<MessageType>(type & PACKET_TYPE_MASK);
+        out.flags = type & ~PACKET_TYPE_MASK;
+        out.data.assign(buffer, readPos + 8, length - 8);
+        readPos += length;
+        out.splitTrace();
+        if (readPos == buffer.size()) {
+            buffer.clear();
+            readPos = 0;
+        }
+        return true;
+    }
+
+    // 已缓存但尚未取出的字节数
+    size_t bufferedBytes() const {
+        return buffer.size() - readPos;
+    }
+
+    // 取出所有已缓存的字节（用于把未收完的帧交给其他路径处理）
+    void takeBuffered(std::string& out) {
+        out.assign(buffer, readPos, std::string::npos);
+        reset();
+    }
+
+    void reset() {
+        buffer.clear();
+        readPos = 0;
+    }
+};
+
+#endif // FRAMEDECODER_H
@@ -17,28 +17,76 @@ enum MessageType : uint32_t {
     SEND_MESSAGE = 3,
     DISCONNECT = 4,
     LIST_CLIENTS = 5,   // 新增：请求客户端列表
+    GRANT_CREDIT = 6,   // 接收方确认已消费 N 条转发消息（数据为 "N"），服务器不回复
+    STREAM_CHUNK = 7,   // 大消息/文件的一个分块（格式见 StreamChunk.h），服务器边收边转发，不回复
+    HELLO = 8,          // 连接建立后协商可选功能：数据为支持的编码/功能（逗号分隔），服务器以 RESPONSE 回复接受的部分（逗号分隔）或 "none"
     RESPONSE = 100,     // 服务器响应
-    CLIENT_LIST = 101   // 服务器响应的客户端列表
+    CLIENT_LIST = 101,  // 服务器响应的客户端列表
+    BACKPRESSURE = 102, // SEND_MESSAGE 因接收方处理不过来而被拒绝（数据为 "targetId:说明"）
+    // 以下仅用于集群节点之间的连接
+    PEER_HELLO = 200,          // 握手，数据为本节点号
+    PEER_BATCH = 201,          // 批量帧：数据为若干个完整序列化的内层数据包
+    PEER_DIRECTORY = 202,      // 客户端目录（完整快照、增量或版本摘要）
+    PEER_FORWARD = 203,        // 跨节点转发 "seq:senderId:targetId:message"
+    PEER_FORWARD_RESULT = 204, // 转发结果 "seq:code"
+    PEER_STREAM = 205          // 跨节点转发流分块：[发送方ID(4)] + STREAM_CHUNK 的数据
 };
 
+// 类型字段的高 8 位是数据包标志，低 24 位才是消息类型
+#define PACKET_TYPE_MASK 0x00FFFFFFu
+#define PACKET_FLAG_ZSTREAM 0x80000000u // 数据用该连接上的流式上下文压缩（见 Compression.h）
+#define PACKET_FLAG_ZDICT 0x40000000u   // 数据用共享字典独立压缩，可以原样转发给协商了同一编码的连接
+#define PACKET_FLAG_MORE 0x20000000u    // 分片：后面还有同一数据包的分片（见 Fragment.h）
+#define PACKET_FLAG_LAST 0x10000000u    // 分片：数据包的最后一个分片
+#define PACKET_FLAG_TRACE 0x08000000u   // 数据之后带有追踪时间戳（见 Trace.h）
+
+// 单个数据包数据部分的默认上限：长度字段超过该值的帧直接判为非法，不为其分配内存。
+// 更大的内容应使用 STREAM_CHUNK 分块发送
+#define DEFAULT_MAX_FRAME_SIZE (16u << 20)
+
 // 数据包结构
 struct Packet {
     MessageType type;
     std::string data;
+    uint32_t flags = 0; // PACKET_FLAG_*，与类型一起编码在类型字段中
+    std::string trace;  // PACKET_FLAG_TRACE 时的时间戳（每个 8 字节），序列化在数据之后
 
     // 序列化数据包到字节流
     std::string serialize() const {
-        uint32_t dataLength = 4 + data.size(); // 4字节用于MessageType
+        bool traced = flags & PACKET_FLAG_TRACE;
+        uint32_t dataLength = 4 + data.size() + (traced ? trace.size() + 1 : 0); // 4字节用于MessageType
         uint32_t netLength = htonl(dataLength + 4); // 总长度包括长度字段本身
-        uint32_t netType = htonl(type);
+        uint32_t netType = htonl(type | flags);
 
         std::string serialized;
+        serialized.reserve(dataLength + 4);
         serialized.append(reinterpret_cast<const char*>(&netLength), sizeof(netLength));
         serialized.append(reinterpret_cast<const char*>(&netType), sizeof(netType));
         serialized.append(data);
+        if (traced) {
+            serialized.append(trace);
+            serialized.push_back(static_cast<char>(trace.size() / 8));
+        }
         return serialized;
     }
 
+    // 收到帧后调用：把追踪尾部从 data 移到 trace，格式不对时抛出异常
+    void splitTrace() {
+        trace.clear();
+        if (!(flags & PACKET_FLAG_TRACE)) {
+            return;
+        }
+        if (data.empty()) {
+            throw std::runtime_error("Missing trace trailer.");
+        }
+        size_t traceSize = static_cast<uint8_t>(data.back()) * 8;
+        if (data.size() < traceSize + 1) {
+            throw std::runtime_error("Invalid trace trailer.");
+        }
+        trace.assign(data, data.size() - 1 - traceSize, traceSize);
+        data.resize(data.size() - 1 - traceSize);
+    }
+
     // 反序列化字节流到数据包
     static Packet deserialize(const std::string& buffer) {
         if (buffer.size() < 8) { // 4字节长度 + 4字节类型
@@ -52,13 +100,15 @@ struct Packet {
         memcpy(&netType, buffer.data() + 4, sizeof(netType));
 
         uint32_t length = ntohl(netLength);
-        pkt.type = static_cast<MessageType>(ntohl(netType));
+        pkt.type = static_cast<MessageType>(ntohl(netType) & PACKET_TYPE_MASK);
+        pkt.flags = ntohl(netType) & ~PACKET_TYPE_MASK;
 
         if (buffer.size() < length) {
             throw std::runtime_error("Buffer does not contain full Packet data.");
         }
 
-        pkt.data = buffer.substr(8, length - 4); // 4字节已用于MessageType
+        pkt.data = buffer.substr(8, length - 8); // 数据部分 = 总长度 - 长度字段 - 类型字段
+        pkt.splitTrace();
         return pkt;
     }
 };
@@ -137,39 +187,44 @@ public:
         }
     }
 
-    // 接收数据包
-    Packet recvPacket() const {
-        // 首先接收长度字段（4字节）
-        char lengthBuffer[4];
-        size_t received = 0;
-        while (received < 4) {
-            ssize_t bytes = recv(sockfd, lengthBuffer + received, 4 - received, 0);
-            if (bytes <= 0) {
-                throw std::runtime_error("Failed to receive packet length.");
-            }
-            received += bytes;
-        }
+    // 接收数据包：先读 8 字节头部并校验长度，再把数据直接读入 Packet（不再整体拷贝两次）
+    Packet recvPacket(size_t maxDataSize = DEFAULT_MAX_FRAME_SIZE) const {
+        char header[8];
+        recvAll(header, sizeof(header), "Failed to receive packet header.");
 
         uint32_t netLength;
-        memcpy(&netLength, lengthBuffer, sizeof(netLength));
+        uint32_t netType;
+        memcpy(&netLength, header, sizeof(netLength));
+        memcpy(&netType, header + 4, sizeof(netType));
         uint32_t length = ntohl(netLength);
+        if (length < 8) {
+            throw std::runtime_error("Invalid packet length.");
+        }
+        if (length - 8 > maxDataSize) {
+            throw std::runtime_error("Packet too large: " + std::to_string(length - 8) + " bytes.");
+        }
 
-        // 接收剩余的数据（length - 4字节已经读取）
-        std::string dataBuffer(length - 4, '\0');
-        received = 0;
-        while (received < (length - 4)) {
-            ssize_t bytes = recv(sockfd, &dataBuffer[received], (length - 4) - received, 0);
+        Packet pkt;
+        pkt.type = static_cast<MessageType>(ntohl(netType) & PACKET_TYPE_MASK);
+        pkt.flags = ntohl(netType) & ~PACKET_TYPE_MASK;
+        pkt.data.resize(length - 8);
+        if (!pkt.data.empty()) {
+            recvAll(&pkt.data[0], pkt.data.size(), "Failed to receive packet data.");
+        }
+        pkt.splitTrace();
+        return pkt;
+    }
+
+    // 读满 len 字节，失败或对端关闭时抛出异常
+    void recvAll(char* buffer, size_t len, const char* error) const {
+        size_t received = 0;
+        while (received < len) {
+            ssize_t bytes = recv(sockfd, buffer + received, len - received, 0);
             if (bytes <= 0) {
-                throw std::runtime_error("Failed to receive packet data.");
+                throw std::runtime_error(error);
             }
             received += bytes;
         }
-
-        // 反序列化数据包
-        std::string fullBuffer;
-        fullBuffer.append(reinterpret_cast<const char*>(&netLength), sizeof(netLength));
-        fullBuffer.append(dataBuffer);
-        return Packet::deserialize(fullBuffer);
     }
 
     // 获取底层socket文件描述符
@@ -0,0 +1,368 @@
+// Scan.h
+// 对消息文本和接收缓冲区的批量扫描：文本校验（UTF-8 + 控制字符）与帧边界遍历
+//
+// - 聊天消息会原样显示在其他客户端的终端上：必须是合法 UTF-8，且不含 \t、\n 以外的 C0 控制字符、
+//   DEL 和 C1 控制字符（U+0080-U+009F，其中 U+009B 在部分终端上等同于 ESC [）
+// - isValidText 在运行时按 CPU 选择实现：AVX2 用 Keiser-Lemire 查表法每次校验 32 字节；
+//   SSE2 整块跳过可打印 ASCII，其余逐字符校验；其他平台用标量实现。各实现结果相同（scan_bench 交叉检查）
+// - scanFrames 一次找出缓冲区中所有完整帧的边界并校验长度，再按边界逐个取出，不必先复制进 FrameDecoder
+// - 分隔符查找仍用 std::string::find：它调用的 memchr 在 glibc 中已按 CPU 选择 SSE2/AVX2 实现
+#ifndef SCAN_H
+#define SCAN_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <arpa/inet.h>
+#include "MySocket.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define SCAN_X86 1
+#endif
+
+// ==================== 文本校验 ====================
+
+// pos 处一个允许的字符的字节数；非法 UTF-8 或控制字符返回 0
+inline size_t textCharLength(const uint8_t* s, size_t len, size_t pos) {
+    uint8_t c = s[pos];
+    if (c < 0x80) {
+        return (c >= 0x20 && c != 0x7F) || c == '\t' || c == '\n' ? 1 : 0;
+    }
+    size_t need;
+    uint8_t low = 0x80; // 第二个字节的范围（排除超长编码、代理项、超过 U+10FFFF 和 C1 控制字符）
+    uint8_t high = 0xBF;
+    if (c >= 0xC2 && c <= 0xDF) {
+        need = 2;
+        low = c == 0xC2 ? 0xA0 : 0x80;
+    } else if (c >= 0xE0 && c <= 0xEF) {
+        need = 3;
+        low = c == 0xE0 ? 0xA0 : 0x80;
+        high = c == 0xED ? 0x9F : 0xBF;
+    } else if (c >= 0xF0 && c <= 0xF4) {
+        need = 4;
+        low = c == 0xF0 ? 0x90 : 0x80;
+        high = c == 0xF4 ? 0x8F : 0xBF;
+    } else {
+        return 0;
+    }
+    if (len - pos < need || s[pos + 1] < low || s[pos + 1] > high) {
+        return 0;
+    }
+    for (size_t i = 2; i < need; i++) {
+        if ((s[pos + i] & 0xC0) != 0x80) {
+            return 0;
+        }
+    }
+    return need;
+}
+
+inline bool isValidTextScalar(const char* data, size_t len) {
+    const uint8_t* s = reinterpret_cast<const uint8_t*>(data);
+    size_t pos = 0;
+    while (pos < len) {
+        size_t n = textCharLength(s, len, pos);
+        if (n == 0) {
+            return false;
+        }
+        pos += n;
+    }
+    return true;
+}
+
+#ifdef SCAN_X86
+
+// 16 字节都是可打印 ASCII、\t 或 \n（x86-64 都支持 SSE2，不需要检测）
+inline bool isPrintableAscii16(const uint8_t* p) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    // 有符号比较：不小于 0x80 的字节是负数，两个比较都不成立
+    __m128i ok = _mm_and_si128(_mm_cmpgt_epi8(x, _mm_set1_epi8(0x1F)), _mm_cmplt_epi8(x, _mm_set1_epi8(0x7F)));
+    ok = _mm_or_si128(ok, _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('\t')), _mm_cmpeq_epi8(x, _mm_set1_epi8('\n'))));
+    return _mm_movemask_epi8(ok) == 0xFFFF;
+}
+
+inline bool isValidTextSse2(const char* data, size_t len) {
+    const uint8_t* s = reinterpret_cast<const uint8_t*>(data);
+    size_t pos = 0;
+    while (pos < len) {
+        while (pos + 16 <= len && isPrintableAscii16(s + pos)) {
+            pos += 16;
+        }
+        // 含其他字节的一段逐字符校验，之后再尝试整块跳过
+        size_t stop = std::min(len, pos + 16);
+        while (pos < stop) {
+            size_t n = textCharLength(s, len, pos);
+            if (n == 0) {
+                return false;
+            }
+            pos += n;
+        }
+    }
+    return true;
+}
+
+// Keiser-Lemire 查表法中的错误类型：由前一字节的高、低 4 位和当前字节的高 4 位各查一张表，三者相与
+#define UTF8_TOO_SHORT (1 << 0)  // 11______ 0_______ 或 11______ 11______
+#define UTF8_TOO_LONG (1 << 1)   // 0_______ 10______
+#define UTF8_OVERLONG_3 (1 << 2) // 11100000 100_____
+#define UTF8_TOO_LARGE (1 << 3)  // 11110100 1001____ 等（超过 U+10FFFF）
+#define UTF8_SURROGATE (1 << 4)  // 11101101 101_____
+#define UTF8_OVERLONG_2 (1 << 5) // 1100000_ 10______
+#define UTF8_TOO_LARGE_1000 (1 << 6) // 11110101 1000____ 等
+#define UTF8_OVERLONG_4 (1 << 6) // 11110000 1000____
+#define UTF8_TWO_CONTS (1 << 7)  // 10______ 10______（第 3、4 字节时合法）
+#define UTF8_CARRY (UTF8_TOO_SHORT | UTF8_TOO_LONG | UTF8_TWO_CONTS)
+
+// 当前 32 字节块向前错开 N 个字节（前面补上一块的末尾）
+template <int N>
+__attribute__((target("avx2"))) inline __m256i avx2Prev(__m256i input, __m256i prevInput) {
+    return _mm256_alignr_epi8(input, _mm256_permute2x128_si256(prevInput, input, 0x21), 16 - N);
+}
+
+__attribute__((target("avx2"))) inline __m256i avx2High4(__m256i x) {
+    return _mm256_and_si256(_mm256_srli_epi16(x, 4), _mm256_set1_epi8(0x0F));
+}
+
+// 一个 32 字节块的 UTF-8 错误（非零表示有错），不检查块末尾未完成的字符
+__attribute__((target("avx2"))) inline __m256i avx2Utf8Errors(__m256i input, __m256i prev1, __m256i prevInput) {
+    const __m256i byte1HighTable = _mm256_setr_epi8(
+        UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+        UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+        UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS,
+        UTF8_TOO_SHORT | UTF8_OVERLONG_2,
+        UTF8_TOO_SHORT,
+        UTF8_TOO_SHORT | UTF8_OVERLONG_3 | UTF8_SURROGATE,
+        UTF8_TOO_SHORT | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4,
+        UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+        UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+        UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS,
+        UTF8_TOO_SHORT | UTF8_OVERLONG_2,
+        UTF8_TOO_SHORT,
+        UTF8_TOO_SHORT | UTF8_OVERLONG_3 | UTF8_SURROGATE,
+        UTF8_TOO_SHORT | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4);
+    const __m256i byte1LowTable = _mm256_setr_epi8(
+        UTF8_CARRY | UTF8_OVERLONG_3 | UTF8_OVERLONG_2 | UTF8_OVERLONG_4,
+        UTF8_CARRY | UTF8_OVERLONG_2,
+        UTF8_CARRY,
+        UTF8_CARRY,
+        UTF8_CARRY | UTF8_TOO_LARGE,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_SURROGATE,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_OVERLONG_3 | UTF8_OVERLONG_2 | UTF8_OVERLONG_4,
+        UTF8_CARRY | UTF8_OVERLONG_2,
+        UTF8_CARRY,
+        UTF8_CARRY,
+        UTF8_CARRY | UTF8_TOO_LARGE,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_SURROGATE,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000);
+    const __m256i byte2HighTable = _mm256_setr_epi8(
+        UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+        UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4,
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE,
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE,
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE,
+        UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+        UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+        UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4,
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE,
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE,
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE,
+        UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT);
+    __m256i special = _mm256_and_si256(
+        _mm256_and_si256(_mm256_shuffle_epi8(byte1HighTable, avx2High4(prev1)),
+                         _mm256_shuffle_epi8(byte1LowTable, _mm256_and_si256(prev1, _mm256_set1_epi8(0x0F)))),
+        _mm256_shuffle_epi8(byte2HighTable, avx2High4(input)));
+    // 三、四字节字符的第 3、4 个字节必须是后续字节：此时 special 中应当恰好有 TWO_CONTS
+    __m256i thirdByte = _mm256_subs_epu8(avx2Prev<2>(input, prevInput), _mm256_set1_epi8(static_cast<char>(0xE0 - 0x80)));
+    __m256i fourthByte = _mm256_subs_epu8(avx2Prev<3>(input, prevInput), _mm256_set1_epi8(static_cast<char>(0xF0 - 0x80)));
+    __m256i must23 = _mm256_and_si256(_mm256_or_si256(thirdByte, fourthByte), _mm256_set1_epi8(static_cast<char>(0x80)));
+    return _mm256_xor_si256(must23, special);
+}
+
+// C0 控制字符（\t、\n 除外）、DEL，以及 C2 80-C2 9F 编码的 C1 控制字符
+__attribute__((target("avx2"))) inline __m256i avx2ControlErrors(__m256i input, __m256i prev1) {
+    __m256i c0 = _mm256_cmpeq_epi8(_mm256_min_epu8(input, _mm256_set1_epi8(0x1F)), input);
+    __m256i allowed = _mm256_or_si256(_mm256_cmpeq_epi8(input, _mm256_set1_epi8('\t')),
+                                      _mm256_cmpeq_epi8(input, _mm256_set1_epi8('\n')));
+    __m256i del = _mm256_cmpeq_epi8(input, _mm256_set1_epi8(0x7F));
+    __m256i c1 = _mm256_and_si256(_mm256_cmpeq_epi8(prev1, _mm256_set1_epi8(static_cast<char>(0xC2))),
+        _mm256_cmpeq_epi8(_mm256_min_epu8(input, _mm256_set1_epi8(static_cast<char>(0x9F))), input));
+    return _mm256_or_si256(_mm256_andnot_si256(allowed, c0), _mm256_or_si256(del, c1));
+}
+
+__attribute__((target("avx2"))) inline bool isValidTextAvx2(const char* data, size_t len) {
+    const uint8_t* s = reinterpret_cast<const uint8_t*>(data);
+    // 块末尾尚未完成的多字节字符（最后 3 个字节分别不小于 F0、E0、C0）
+    const __m256i incompleteLimit = _mm256_setr_epi8(
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        static_cast<char>(0xF0 - 1), static_cast<char>(0xE0 - 1), static_cast<char>(0xC0 - 1));
+    __m256i error = _mm256_setzero_si256();
+    __m256i prevInput = _mm256_setzero_si256();
+    __m256i prevIncomplete = _mm256_setzero_si256();
+    size_t done = 0;
+    for (; done + 32 <= len; done += 32) {
+        __m256i input = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + done));
+        // 最常见的整块可打印 ASCII（有符号比较，同 isPrintableAscii16）：只需确认上一块没有以未完成的字符结尾
+        __m256i printable = _mm256_and_si256(_mm256_cmpgt_epi8(input, _mm256_set1_epi8(0x1F)),
+                                             _mm256_cmpgt_epi8(_mm256_set1_epi8(0x7F), input));
+        printable = _mm256_or_si256(printable, _mm256_or_si256(_mm256_cmpeq_epi8(input, _mm256_set1_epi8('\t')),
+                                                               _mm256_cmpeq_epi8(input, _mm256_set1_epi8('\n'))));
+        if (_mm256_movemask_epi8(printable) == -1) {
+            error = _mm256_or_si256(error, prevIncomplete);
+            prevIncomplete = _mm256_setzero_si256();
+        } else {
+            __m256i prev1 = avx2Prev<1>(input, prevInput);
+            error = _mm256_or_si256(error, avx2ControlErrors(input, prev1));
+            error = _mm256_or_si256(error, avx2Utf8Errors(input, prev1, prevInput));
+            prevIncomplete = _mm256_subs_epu8(input, incompleteLimit);
+        }
+        prevInput = input;
+    }
+    if (!_mm256_testz_si256(error, error)) {
+        return false;
+    }
+    // 剩余不足 32 字节的部分从最后一个可能未完成的字符开始逐字符校验
+    size_t pos = done >= 3 ? done - 3 : 0;
+    while (pos < done && (s[pos] & 0xC0) == 0x80) {
+        pos++;
+    }
+    while (pos < len) {
+        size_t n = textCharLength(s, len, pos);
+        if (n == 0) {
+            return false;
+        }
+        pos += n;
+    }
+    return true;
+}
+
+#endif // SCAN_X86
+
+typedef bool (*TextValidator)(const char* data, size_t len);
+
+inline TextValidator selectTextValidator(const char** name = nullptr) {
+    const char* chosen = "scalar";
+    TextValidator validator = isValidTextScalar;
+#ifdef SCAN_X86
+    if (__builtin_cpu_supports("avx2")) {
+        chosen = "avx2";
+        validator = isValidTextAvx2;
+    } else {
+        chosen = "sse2";
+        validator = isValidTextSse2;
+    }
+#endif
+    if (name != nullptr) {
+        *name = chosen;
+    }
+    return validator;
+}
+
+// 当前 CPU 上 isValidText 使用的实现（"avx2"、"sse2" 或 "scalar"）
+inline const char* textScanImplementation() {
+    const char* name;
+    selectTextValidator(&name);
+    return name;
+}
+
+// 是否可以原样显示在终端上：合法 UTF-8，且不含 \t、\n 以外的控制字符
+inline bool isValidText(const char* data, size_t len) {
+    static const TextValidator validator = selectTextValidator();
+    return validator(data, len);
+}
+
+inline bool isValidText(const std::string& text) {
+    return isValidText(text.data(), text.size());
+}
+
+// 把不能原样显示的字节替换为 \xNN
+inline std::string escapeText(const std::string& text) {
+    if (isValidText(text)) {
+        return text;
+    }
+    const uint8_t* s = reinterpret_cast<const uint8_t*>(text.data());
+    std::string out;
+    out.reserve(text.size() + 16);
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t n = textCharLength(s, text.size(), pos);
+        if (n > 0) {
+            out.append(text, pos, n);
+            pos += n;
+        } else {
+            char escaped[5];
+            snprintf(escaped, sizeof(escaped), "\\x%02X", s[pos]);
+            out += escaped;
+            pos++;
+        }
+    }
+    return out;
+}
+
+// ==================== 帧边界 ====================
+
+struct FrameSpan {
+    size_t offset;   // 帧在缓冲区中的起始位置
+    uint32_t length; // 总长度（含 8 字节头部）
+    uint32_t type;   // 类型字段（含标志位）
+};
+
+// 找出 data 中连续的完整帧，把边界追加到 spans，返回完整帧覆盖的字节数（其后是不完整的帧）。
+// 帧长度非法（小于头部或数据部分超过 maxDataSize）时抛出 std::runtime_error
+inline size_t scanFrames(const char* data, size_t len, size_t maxDataSize, std::vector<FrameSpan>& spans) {
+    size_t pos = 0;
+    while (len - pos >= 8) {
+        uint32_t netLength;
+        uint32_t netType;
+        memcpy(&netLength, data + pos, sizeof(netLength));
+        memcpy(&netType, data + pos + 4, sizeof(netType));
+        uint32_t length = ntohl(netLength);
+        if (length < 8) {
+            throw std::runtime_error("Invalid packet length.");
+        }
+        if (length - 8 > maxDataSize) {
+            throw std::runtime_error("Packet too large: " + std::to_string(length - 8) + " bytes.");
+        }
+        if (len - pos < length) {
+            break;
+        }
+        spans.push_back(FrameSpan{pos, length, ntohl(netType)});
+        pos += length;
+    }
+    return pos;
+}
+
+// 按 scanFrames 找到的边界取出一个数据包
+inline void loadFrame(const char* data, const FrameSpan& span, Packet& out) {
+    out.type = static_cast<MessageType>(span.type & PACKET_TYPE_MASK);
+    out.flags = span.type & ~PACKET_TYPE_MASK;
+    out.data.assign(data + span.offset + 8, span.length - 8);
+    out.splitTrace();
+}
+
+#endif // SCAN_H
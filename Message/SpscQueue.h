@@ -0,0 +1,189 @@
+// SpscQueue.h
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+// 单生产者/单消费者无锁有界环形队列
+// - 槽位只做移动构造/移动赋值，不拷贝元素
+// - 消费者空闲时先自旋，再在 eventfd 上休眠；生产者只在消费者休眠时写 eventfd，
+//   因此一批连续入队只会产生一次唤醒
+// - busyPoll 模式下消费者永不休眠，用 CPU 换取更低的延迟
+template <typename T>
+class SpscQueue {
+private:
+    static constexpr size_t CACHE_LINE = 64;
+    static constexpr int SPIN_BEFORE_PARK = 2000; // 休眠前的自旋次数
+
+    typedef typename std::aligned_storage<sizeof(T), alignof(T)>::type Slot;
+
+    const size_t capacity;
+    const size_t mask;
+    Slot* slots;
+    const bool busyPoll;
+    int wakeFd;
+
+    // 消费者侧
+    alignas(CACHE_LINE) std::atomic<size_t> head;
+    size_t cachedTail;
+    // 生产者侧
+    alignas(CACHE_LINE) std::atomic<size_t> tail;
+    size_t cachedHead;
+    // 消费者是否在 eventfd 上休眠
+    alignas(CACHE_LINE) std::atomic<bool> sleeping;
+    std::atomic<bool> closed;
+
+    static size_t roundUpPow2(size_t n) {
+        size_t p = 1;
+        while (p < n) {
+            p <<= 1;
+        }
+        return p;
+    }
+
+    T* slotAt(size_t index) {
+        return reinterpret_cast<T*>(&slots[index & mask]);
+    }
+
+    void signal() {
+        uint64_t one = 1;
+        ssize_t ret = write(wakeFd, &one, sizeof(one));
+        (void)ret;
+    }
+
+    void park() {
+        uint64_t value;
+        ssize_t ret = read(wakeFd, &value, sizeof(value));
+        (void)ret;
+    }
+
+public:
+    explicit SpscQueue(size_t cap, bool busyPollMode = false)
+        : capacity(roundUpPow2(cap < 2 ? 2 : cap)),
+          mask(capacity - 1),
+          slots(new Slot[capacity]),
+          busyPoll(busyPollMode),
+          wakeFd(eventfd(0, EFD_CLOEXEC)),
+          head(0), cachedTail(0),
+          tail(0), cachedHead(0),
+          sleeping(false), closed(false) {
+        if (wakeFd < 0) {
+            delete[] slots;
+            throw std::runtime_error("Failed to create eventfd for SpscQueue.");
+        }
+    }
+
+    ~SpscQueue() {
+        T tmp;
+        while (tryPop(tmp)) {
+        }
+        delete[] slots;
+        ::close(wakeFd);
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // 生产者：尝试入队，队列满时返回 false
+    bool tryPush(T&& value) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - cachedHead >= capacity) {
+            cachedHead = head.load(std::memory_order_acquire);
+            if (t - cachedHead >= capacity) {
+                return false;
+            }
+        }
+        new (slotAt(t)) T(std::move(value));
+        tail.store(t + 1, std::memory_order_release);
+        // 仅当消费者已休眠时才唤醒它（fence 与消费者的 sleeping/tail 复查配对）
+        if (!busyPoll) {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (sleeping.load(std::memory_order_relaxed) &&
+                sleeping.exchange(false, std::memory_order_acq_rel)) {
+                signal();
+            }
+        }
+        return true;
+    }
+
+    // 生产者：入队，队列满时退避等待；队列关闭后返回 false
+    bool push(T&& value) {
+        int spins = 0;
+        while (!tryPush(std::move(value))) {
+            if (closed.load(std::memory_order_acquire)) {
+                return false;
+            }
+            if (++spins < 64) {
+                std::this_thread::yield();
+            } else {
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+        }
+        return true;
+    }
+
+    // 消费者：尝试出队，队列空时返回 false
+    bool tryPop(T& out) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == cachedTail) {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (h == cachedTail) {
+                return false;
+            }
+        }
+        T* slot = slotAt(h);
+        out = std::move(*slot);
+        slot->~T();
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 消费者：阻塞直到取到一个元素；队列关闭且为空时返回 false
+    bool waitPop(T& out) {
+        int spins = 0;
+        while (true) {
+            if (tryPop(out)) {
+                return true;
+            }
+            if (closed.load(std::memory_order_acquire)) {
+                return tryPop(out);
+            }
+            if (busyPoll || ++spins < SPIN_BEFORE_PARK) {
+                continue;
+            }
+            // 先声明休眠再复查，避免与生产者的入队竞争而丢失唤醒
+            sleeping.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (tail.load(std::memory_order_relaxed) != head.load(std::memory_order_relaxed) ||
+                closed.load(std::memory_order_acquire)) {
+                sleeping.store(false, std::memory_order_relaxed);
+            } else {
+                park();
+            }
+            spins = 0;
+        }
+    }
+
+    // 关闭队列并唤醒休眠的消费者（用于退出）
+    void close() {
+        closed.store(true, std::memory_order_release);
+        sleeping.store(false, std::memory_order_relaxed);
+        signal();
+    }
+
+    bool isClosed() const {
+        return closed.load(std::memory_order_acquire);
+    }
+};
+
+#endif // SPSCQUEUE_H
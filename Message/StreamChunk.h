@@ -0,0 +1,70 @@
+// StreamChunk.h
+// 大消息/文件的分块传输（STREAM_CHUNK）
+//
+// 数据格式：[对端客户端ID(4)][流ID(4)][标志(4)][分块数据]，整数均为大端序
+// - 客户端发出时对端ID为接收方，服务器转发前改写为发送方
+// - 流ID由发送方分配，(发送方, 流ID) 唯一确定一个流；同一个流的分块必须在同一连接上按顺序发送
+// - 第一个分块带 STREAM_FLAG_BEGIN，数据为流的名字（例如文件名）；最后一个分块带 STREAM_FLAG_END
+// - 无法投递时服务器向发送方回送 STREAM_FLAG_ABORT 分块，数据为原因
+#ifndef STREAMCHUNK_H
+#define STREAMCHUNK_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <arpa/inet.h>
+#include "MySocket.h"
+
+#define STREAM_HEADER_SIZE 12
+#define STREAM_CHUNK_SIZE (64 << 10) // 发送方默认的分块大小
+
+#define STREAM_FLAG_BEGIN 1
+#define STREAM_FLAG_END 2
+#define STREAM_FLAG_ABORT 4
+
+struct StreamChunk {
+    uint32_t peerId;
+    uint32_t streamId;
+    uint32_t flags;
+    std::string payload;
+
+    Packet toPacket() const {
+        Packet pkt;
+        pkt.type = STREAM_CHUNK;
+        pkt.data.reserve(STREAM_HEADER_SIZE + payload.size());
+        appendU32(pkt.data, peerId);
+        appendU32(pkt.data, streamId);
+        appendU32(pkt.data, flags);
+        pkt.data.append(payload);
+        return pkt;
+    }
+
+    // 解析 STREAM_CHUNK 的数据部分，长度不足时返回 false
+    static bool parse(const std::string& data, StreamChunk& out) {
+        if (data.size() < STREAM_HEADER_SIZE) {
+            return false;
+        }
+        out.peerId = readU32(data, 0);
+        out.streamId = readU32(data, 4);
+        out.flags = readU32(data, 8);
+        out.payload.assign(data, STREAM_HEADER_SIZE, std::string::npos);
+        return true;
+    }
+
+    // 以下直接操作数据部分的头部，转发时无需拷贝分块数据
+    static uint32_t readU32(const std::string& data, size_t offset) {
+        uint32_t value;
+        memcpy(&value, data.data() + offset, sizeof(value));
+        return ntohl(value);
+    }
+    static void writeU32(std::string& data, size_t offset, uint32_t value) {
+        uint32_t netValue = htonl(value);
+        memcpy(&data[offset], &netValue, sizeof(netValue));
+    }
+    static void appendU32(std::string& data, uint32_t value) {
+        uint32_t netValue = htonl(value);
+        data.append(reinterpret_cast<const char*>(&netValue), sizeof(netValue));
+    }
+};
+
+#endif // STREAMCHUNK_H
@@ -0,0 +1,160 @@
+// Trace.h
+// 端到端延迟追踪：带 PACKET_FLAG_TRACE 的数据包在数据之后携带一串时间戳，沿途每一跳各追加一个
+//
+// 帧格式：[长度][类型|PACKET_FLAG_TRACE][数据][时间戳 * N][N(1)]，时间戳为 8 字节大端序：
+// 高 8 位是阶段（TraceStage），低 56 位是 CLOCK_MONOTONIC 纳秒。追踪尾部不参与压缩，也不计入 Packet::data
+// - 请求：客户端发送 -> 服务器收到 -> 开始处理 -> 响应进入发送队列 -> 写入 socket -> 客户端收到响应
+// - 转发的消息：客户端发送 -> 服务器收到 -> 开始处理 ->（跨节点时：对端节点收到）-> 进入接收方的发送队列
+//   -> 写入 socket -> 接收方收到
+// 不同主机的单调时钟没有共同起点，跨主机的阶段差值只在同一台机器上有意义
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include <arpa/inet.h>
+#include "MySocket.h"
+
+#define TRACE_MAX_STAMPS 16       // 每个数据包最多携带的时间戳数（超过后不再追加）
+#define TRACE_MAX_SAMPLES 100000  // TraceStats 每个阶段最多保留的样本数
+
+enum TraceStage : uint8_t {
+    TRACE_CLIENT_SEND = 1,     // 客户端发出请求
+    TRACE_SERVER_RECV = 2,     // 服务器从 socket 读到该帧的最后一个字节
+    TRACE_SERVER_DISPATCH = 3, // 服务器开始处理
+    TRACE_PEER_RECV = 4,       // 集群中目标客户端所在节点收到转发
+    TRACE_SERVER_ENQUEUE = 5,  // 放入目标连接的发送队列
+    TRACE_SERVER_FLUSH = 6,    // 从发送队列取出、写入 socket
+    TRACE_CLIENT_RECV = 7,     // 客户端收到响应
+    TRACE_CLIENT_DELIVER = 8   // 接收方收到转发的消息
+};
+
+inline const char* traceStageName(uint8_t stage) {
+    switch (stage) {
+    case TRACE_CLIENT_SEND: return "client_send";
+    case TRACE_SERVER_RECV: return "server_recv";
+    case TRACE_SERVER_DISPATCH: return "dispatch";
+    case TRACE_PEER_RECV: return "peer_recv";
+    case TRACE_SERVER_ENQUEUE: return "enqueue";
+    case TRACE_SERVER_FLUSH: return "flush";
+    case TRACE_CLIENT_RECV: return "client_recv";
+    case TRACE_CLIENT_DELIVER: return "deliver";
+    default: return "unknown";
+    }
+}
+
+inline uint64_t traceNowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+}
+
+// 给带追踪的数据包追加一个时间戳；未开启追踪的数据包不变
+inline void traceStamp(Packet& pkt, TraceStage stage, uint64_t ns = traceNowNs()) {
+    if (!(pkt.flags & PACKET_FLAG_TRACE) || pkt.trace.size() >= TRACE_MAX_STAMPS * 8) {
+        return;
+    }
+    uint64_t value = (static_cast<uint64_t>(stage) << 56) | (ns & 0x00FFFFFFFFFFFFFFull);
+    uint32_t high = htonl(static_cast<uint32_t>(value >> 32));
+    uint32_t low = htonl(static_cast<uint32_t>(value));
+    pkt.trace.append(reinterpret_cast<const char*>(&high), sizeof(high));
+    pkt.trace.append(reinterpret_cast<const char*>(&low), sizeof(low));
+}
+
+// 开启追踪并记录第一个时间戳
+inline void traceStart(Packet& pkt, TraceStage stage) {
+    pkt.flags |= PACKET_FLAG_TRACE;
+    pkt.trace.clear();
+    traceStamp(pkt, stage);
+}
+
+// 解析为 (阶段, 纳秒) 列表
+inline std::vector<std::pair<uint8_t, uint64_t>> traceParse(const std::string& trace) {
+    std::vector<std::pair<uint8_t, uint64_t>> stamps;
+    for (size_t pos = 0; pos + 8 <= trace.size(); pos += 8) {
+        uint32_t high;
+        uint32_t low;
+        memcpy(&high, trace.data() + pos, sizeof(high));
+        memcpy(&low, trace.data() + pos + 4, sizeof(low));
+        uint64_t value = (static_cast<uint64_t>(ntohl(high)) << 32) | ntohl(low);
+        stamps.emplace_back(static_cast<uint8_t>(value >> 56), value & 0x00FFFFFFFFFFFFFFull);
+    }
+    return stamps;
+}
+
+// 按 "路径 阶段A->阶段B" 汇总相邻时间戳的差值（线程安全）
+class TraceStats {
+public:
+    // path 区分不同的数据包路径，例如 "response"、"forward"
+    void record(const std::string& path, const std::string& trace) {
+        std::vector<std::pair<uint8_t, uint64_t>> stamps = traceParse(trace);
+        if (stamps.size() < 2) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t i = 0; i + 1 < stamps.size(); i++) {
+            add(StageKey(path, stamps[i].first, stamps[i + 1].first), stamps[i].second, stamps[i + 1].second);
+        }
+        add(StageKey(path, TRACE_TOTAL, TRACE_TOTAL), stamps.front().second, stamps.back().second);
+    }
+
+    // 每行一个阶段：样本数与 p50/p90/p99/最大值（微秒）
+    std::string describe() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::ostringstream out;
+        out.setf(std::ios::fixed);
+        out.precision(1);
+        for (const auto& [key, samples] : stages) {
+            std::vector<uint64_t> sorted = samples;
+            std::sort(sorted.begin(), sorted.end());
+            out << std::get<0>(key) << " ";
+            if (std::get<1>(key) == TRACE_TOTAL) {
+                out << "total";
+            } else {
+                out << traceStageName(std::get<1>(key)) << "->" << traceStageName(std::get<2>(key));
+            }
+            out << ": n=" << sorted.size()
+                << " p50=" << percentile(sorted, 0.5) / 1000.0
+                << "us p90=" << percentile(sorted, 0.9) / 1000.0
+                << "us p99=" << percentile(sorted, 0.99) / 1000.0
+                << "us max=" << sorted.back() / 1000.0 << "us\n";
+        }
+        return out.str();
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex);
+        stages.clear();
+    }
+
+private:
+    // (路径, 起始阶段, 结束阶段)：同一路径的阶段相邻并按流水线顺序排列，总耗时排在最后
+    typedef std::tuple<std::string, uint8_t, uint8_t> StageKey;
+    static constexpr uint8_t TRACE_TOTAL = 0xFF;
+
+    mutable std::mutex mutex;
+    std::map<StageKey, std::vector<uint64_t>> stages;
+
+    void add(const StageKey& key, uint64_t from, uint64_t to) {
+        std::vector<uint64_t>& samples = stages[key];
+        if (samples.size() < TRACE_MAX_SAMPLES) {
+            samples.push_back(to > from ? to - from : 0);
+        }
+    }
+
+    static uint64_t percentile(const std::vector<uint64_t>& sorted, double p) {
+        return sorted[static_cast<size_t>(p * (sorted.size() - 1))];
+    }
+};
+
+#endif // TRACE_H
@@ -0,0 +1,256 @@
+// Acceptor.cpp
+
+#include "Acceptor.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <glog/logging.h>
+#include "Message/MySocket.h"
+#include "CpuAffinity.h"
+
+#define MAX_HANDOFF_SAMPLES 65536 // 每个统计周期最多保留的交接延迟样本数
+
+namespace {
+
+// 拒绝连接时发送的 DISCONNECT（只序列化一次）
+const std::string& busyPacket() {
+    static const std::string serialized = [] {
+        Packet pkt;
+        pkt.type = DISCONNECT;
+        pkt.data = "Server busy, please retry later.";
+        return pkt.serialize();
+    }();
+    return serialized;
+}
+
+// 超过 net.core.busy_poll 的值需要 CAP_NET_ADMIN，失败只记录一次（仅在接受线程中调用）
+void setBusyPoll(int fd, uint32_t busyPollUs) {
+    static bool warned = false;
+    int value = static_cast<int>(busyPollUs);
+    if (setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &value, sizeof(value)) < 0 && !warned) {
+        warned = true;
+        LOG(ERROR) << "Failed to set SO_BUSY_POLL on client sockets: " << strerror(errno);
+    }
+}
+
+uint32_t percentile(const std::vector<uint32_t>& sorted, double p) {
+    size_t index = static_cast<size_t>(p * (sorted.size() - 1));
+    return sorted[index];
+}
+
+} // namespace
+
+Acceptor::Acceptor(EventLoop& l, int fd, const ServerConfig& c, AcceptFn cb)
+    : loop(l), listenFd(fd), config(c), onAccept(std::move(cb)), wakeFd(-1), spareFd(-1),
+      running(false), activeConnections(0), accepted(0), rejectedTotal(0), rejectedPerIp(0),
+      acceptErrors(0), largestBatch(0) {
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeFd < 0) {
+        throw std::runtime_error(std::string("Failed to create acceptor eventfd: ") + strerror(errno));
+    }
+    spareFd = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+}
+
+Acceptor::~Acceptor() {
+    stop();
+    ::close(wakeFd);
+    if (spareFd >= 0) {
+        ::close(spareFd);
+    }
+}
+
+void Acceptor::start() {
+    running = true;
+    acceptThread = std::thread([this] { acceptLoop(); });
+}
+
+void Acceptor::stop() {
+    if (!running.exchange(false)) {
+        return;
+    }
+    uint64_t one = 1;
+    ssize_t n = ::write(wakeFd, &one, sizeof(one));
+    (void)n;
+    if (acceptThread.joinable()) {
+        acceptThread.join();
+    }
+}
+
+void Acceptor::acceptLoop() {
+    pinCurrentThread(config.acceptCpus, "accept");
+    int epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd < 0) {
+        LOG(ERROR) << "Acceptor failed to create epoll: " << strerror(errno);
+        return;
+    }
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = listenFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &ev);
+    ev.data.fd = wakeFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &ev);
+
+    struct epoll_event events[2];
+    while (running) {
+        int n = epoll_wait(epollFd, events, 2, -1);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LOG(ERROR) << "Acceptor epoll_wait failed: " << strerror(errno);
+            break;
+        }
+        for (int i = 0; i < n && running; i++) {
+            if (events[i].data.fd == listenFd) {
+                acceptBatch();
+            }
+        }
+    }
+    ::close(epollFd);
+}
+
+// 取空监听队列：每 ACCEPT_BATCH 个连接向事件循环投递一次
+void Acceptor::acceptBatch() {
+    bool drained = false;
+    while (!drained && running) {
+        auto batch = std::make_shared<std::vector<AcceptedClient>>();
+        batch->reserve(ACCEPT_BATCH);
+        while (batch->size() < ACCEPT_BATCH) {
+            struct sockaddr_in address;
+            socklen_t addressLength = sizeof(address);
+            int fd = accept4(listenFd, (struct sockaddr*)&address, &addressLength, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                if (errno == EINTR || errno == ECONNABORTED) {
+                    continue;
+                }
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    drained = true;
+                    break;
+                }
+                acceptErrors++;
+                if ((errno == EMFILE || errno == ENFILE) && dropOnFdExhaustion()) {
+                    continue;
+                }
+                LOG(ERROR) << "accept4 failed on port " << config.port << ": " << strerror(errno);
+                drained = true;
+                break;
+            }
+            char ip[INET_ADDRSTRLEN];
+            inet_ntop(AF_INET, &address.sin_addr, ip, sizeof(ip));
+            if (!admit(ip)) {
+                reject(fd);
+                continue;
+            }
+            if (config.busyPollUs > 0) {
+                setBusyPoll(fd, config.busyPollUs);
+            }
+            batch->push_back(AcceptedClient{fd, ip, ntohs(address.sin_port), std::chrono::steady_clock::now()});
+        }
+        if (batch->empty()) {
+            continue;
+        }
+        accepted += batch->size();
+        uint32_t size = static_cast<uint32_t>(batch->size());
+        uint32_t largest = largestBatch.load(std::memory_order_relaxed);
+        while (size > largest && !largestBatch.compare_exchange_weak(largest, size)) {
+        }
+        loop.post([this, batch] {
+            auto now = std::chrono::steady_clock::now();
+            for (const AcceptedClient& client : *batch) {
+                if (handoffMicros.size() < MAX_HANDOFF_SAMPLES) {
+                    handoffMicros.push_back(static_cast<uint32_t>(
+                        std::chrono::duration_cast<std::chrono::microseconds>(now - client.acceptedAt).count()));
+                }
+                onAccept(client);
+            }
+        });
+    }
+}
+
+bool Acceptor::admit(const std::string& ip) {
+    std::lock_guard<std::mutex> lock(admissionMutex);
+    if (config.maxConnections != 0 && activeConnections >= config.maxConnections) {
+        rejectedTotal++;
+        return false;
+    }
+    if (config.maxConnectionsPerIp != 0) {
+        uint32_t& count = connectionsPerIp[ip];
+        if (count >= config.maxConnectionsPerIp) {
+            rejectedTotal++;
+            rejectedPerIp++;
+            return false;
+        }
+        count++;
+    }
+    activeConnections++;
+    return true;
+}
+
+void Acceptor::release(const std::string& ip) {
+    std::lock_guard<std::mutex> lock(admissionMutex);
+    if (activeConnections > 0) {
+        activeConnections--;
+    }
+    if (config.maxConnectionsPerIp != 0) {
+        auto it = connectionsPerIp.find(ip);
+        if (it != connectionsPerIp.end() && --it->second == 0) {
+            connectionsPerIp.erase(it);
+        }
+    }
+}
+
+// 过载时的拒绝路径：尽力发送一次 DISCONNECT（不等待），然后立即关闭
+void Acceptor::reject(int fd) {
+    const std::string& packet = busyPacket();
+    ssize_t n = ::send(fd, packet.data(), packet.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+    (void)n;
+    ::close(fd);
+}
+
+// 描述符耗尽时监听 socket 会一直可读：释放预留描述符，接受并关闭一个连接后再占回
+bool Acceptor::dropOnFdExhaustion() {
+    if (spareFd < 0) {
+        return false;
+    }
+    ::close(spareFd);
+    int fd = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd >= 0) {
+        rejectedTotal++;
+        reject(fd);
+    }
+    spareFd = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+    LOG(ERROR) << "Out of file descriptors, rejected an incoming connection on port " << config.port << ".";
+    return fd >= 0;
+}
+
+std::string Acceptor::describeStats() {
+    uint32_t active;
+    {
+        std::lock_guard<std::mutex> lock(admissionMutex);
+        active = activeConnections;
+    }
+    std::ostringstream out;
+    out << "active=" << active << " accepted=" << accepted << " rejected=" << rejectedTotal
+        << " (per-ip " << rejectedPerIp << ") errors=" << acceptErrors
+        << " largest_batch=" << largestBatch;
+    if (!handoffMicros.empty()) {
+        std::sort(handoffMicros.begin(), handoffMicros.end());
+        out << " handoff_us p50=" << percentile(handoffMicros, 0.5)
+            << " p99=" << percentile(handoffMicros, 0.99)
+            << " max=" << handoffMicros.back()
+            << " n=" << handoffMicros.size();
+        handoffMicros.clear();
+    }
+    return out.str();
+}
@@ -0,0 +1,83 @@
+// Acceptor.h
+// 专用的接受线程：批量 accept4 新连接，做准入控制后成批交给事件循环
+//
+// - 监听 socket 可读时循环 accept4(SOCK_NONBLOCK | SOCK_CLOEXEC) 直到队列取空（每批最多 ACCEPT_BATCH 个），
+//   每批只向事件循环投递一次，重连风暴时事件循环不会被逐个连接唤醒
+// - 超出总连接数或单个 IP 的连接数上限时，直接回一个 DISCONNECT 并关闭，不创建任何连接状态
+// - 文件描述符耗尽（EMFILE）时用预留的描述符接受并立即关闭，避免监听 socket 一直可读而空转
+// - 统计接受数、拒绝数、批大小，以及从 accept4 返回到事件循环开始处理该连接的交接延迟
+#ifndef ACCEPTOR_H
+#define ACCEPTOR_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "EventLoop.h"
+#include "ServerConfig.h"
+
+#define ACCEPT_BATCH 64 // 每次投递给事件循环的最大连接数
+
+// 已接受、通过准入检查的连接
+struct AcceptedClient {
+    int fd;
+    std::string ip;
+    int port;
+    std::chrono::steady_clock::time_point acceptedAt;
+};
+
+class Acceptor {
+public:
+    // 在事件循环线程中为每个新连接调用
+    typedef std::function<void(const AcceptedClient& client)> AcceptFn;
+
+    Acceptor(EventLoop& loop, int listenFd, const ServerConfig& config, AcceptFn onAccept);
+    ~Acceptor();
+
+    Acceptor(const Acceptor&) = delete;
+    Acceptor& operator=(const Acceptor&) = delete;
+
+    void start();
+    // 停止接受线程（不关闭监听 socket）
+    void stop();
+
+    // 连接关闭时调用（任意线程），归还准入名额
+    void release(const std::string& ip);
+
+    // 以下仅在事件循环线程中调用
+    std::string describeStats();
+
+private:
+    EventLoop& loop;
+    int listenFd;
+    const ServerConfig& config;
+    AcceptFn onAccept;
+    int wakeFd;
+    int spareFd; // EMFILE 时临时释放，用于接受并关闭连接
+    std::atomic<bool> running;
+    std::thread acceptThread;
+
+    std::mutex admissionMutex;
+    uint32_t activeConnections;
+    std::unordered_map<std::string, uint32_t> connectionsPerIp;
+
+    std::atomic<uint64_t> accepted;
+    std::atomic<uint64_t> rejectedTotal;
+    std::atomic<uint64_t> rejectedPerIp;
+    std::atomic<uint64_t> acceptErrors;
+    std::atomic<uint32_t> largestBatch;
+    std::vector<uint32_t> handoffMicros; // 本统计周期内的交接延迟（事件循环线程）
+
+    void acceptLoop();
+    void acceptBatch();
+    bool admit(const std::string& ip);
+    void reject(int fd);
+    bool dropOnFdExhaustion();
+};
+
+#endif // ACCEPTOR_H
@@ -0,0 +1,90 @@
+// AsyncEvent.h
+// 一次性事件：一个处理函数 co_await 等待，另一个处理函数（例如目标客户端的回复）set() 唤醒
+#ifndef ASYNCEVENT_H
+#define ASYNCEVENT_H
+
+#include <coroutine>
+#include <optional>
+#include <utility>
+#include <vector>
+#include "EventLoop.h"
+
+template <typename T>
+class AsyncEvent {
+private:
+    struct Waiter {
+        std::coroutine_handle<> handle;
+        EventLoop::TimerId timer;
+        bool timedOut;
+    };
+
+    EventLoop& loop;
+    std::optional<T> value;
+    std::vector<Waiter*> waiters;
+
+    void removeWaiter(Waiter* w) {
+        for (size_t i = 0; i < waiters.size(); i++) {
+            if (waiters[i] == w) {
+                waiters.erase(waiters.begin() + i);
+                return;
+            }
+        }
+    }
+
+public:
+    explicit AsyncEvent(EventLoop& l) : loop(l) {}
+
+    AsyncEvent(const AsyncEvent&) = delete;
+    AsyncEvent& operator=(const AsyncEvent&) = delete;
+
+    bool isSet() const { return value.has_value(); }
+
+    // 设置结果并唤醒所有等待者；重复调用只保留第一次的结果
+    void set(T v) {
+        if (value) {
+            return;
+        }
+        value = std::move(v);
+        std::vector<Waiter*> pending;
+        pending.swap(waiters);
+        for (Waiter* w : pending) {
+            if (w->timer != 0) {
+                loop.cancelTimer(w->timer);
+            }
+            loop.schedule(w->handle);
+        }
+    }
+
+    // co_await event.wait(timeoutMs)：返回结果；timeoutMs <= 0 表示一直等待，超时返回 std::nullopt
+    struct Awaiter {
+        AsyncEvent& event;
+        int timeoutMs;
+        Waiter waiter;
+
+        bool await_ready() const noexcept { return event.isSet(); }
+        void await_suspend(std::coroutine_handle<> h) {
+            waiter.handle = h;
+            waiter.timer = 0;
+            waiter.timedOut = false;
+            event.waiters.push_back(&waiter);
+            if (timeoutMs > 0) {
+                Waiter* w = &waiter;
+                AsyncEvent* e = &event;
+                waiter.timer = event.loop.runAfter(timeoutMs, [e, w] {
+                    w->timedOut = true;
+                    e->removeWaiter(w);
+                    e->loop.schedule(w->handle);
+                });
+            }
+        }
+        std::optional<T> await_resume() {
+            if (waiter.timedOut || !event.value) {
+                return std::nullopt;
+            }
+            return event.value;
+        }
+    };
+    Awaiter wait(int timeoutMs = 0) { return Awaiter{*this, timeoutMs, Waiter()}; }
+};
+
+#endif // ASYNCEVENT_H
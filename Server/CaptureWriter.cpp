@@ -0,0 +1,120 @@
+// CaptureWriter.cpp
+
+#include "CaptureWriter.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/time.h>
+#include <unistd.h>
+#include <glog/logging.h>
+#include "CpuAffinity.h"
+
+CaptureWriter::CaptureWriter(const std::string& path, const std::vector<int>& cpus)
+    : fd(-1), start(std::chrono::steady_clock::now()), queue(CAPTURE_QUEUE_CAPACITY), writerCpus(cpus),
+      recorded(0), dropped(0), writeFailed(false), queuedBytes(0) {
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open capture file " + path + ": " + strerror(errno));
+    }
+    struct timeval now;
+    gettimeofday(&now, nullptr);
+    uint64_t startUs = static_cast<uint64_t>(now.tv_sec) * 1000000 + now.tv_usec;
+    std::string header(CAPTURE_MAGIC, 8);
+    char time[8];
+    CaptureRecord::writeU32(time, static_cast<uint32_t>(startUs >> 32));
+    CaptureRecord::writeU32(time + 4, static_cast<uint32_t>(startUs));
+    header.append(time, sizeof(time));
+    if (!writeAll(header)) {
+        ::close(fd);
+        throw std::runtime_error("Failed to write capture file " + path + ": " + strerror(errno));
+    }
+    writerThread = std::thread([this] { writerLoop(); });
+}
+
+CaptureWriter::~CaptureWriter() {
+    queue.close();
+    if (writerThread.joinable()) {
+        writerThread.join();
+    }
+    ::close(fd);
+}
+
+void CaptureWriter::connectionOpened(int clientId, const std::string& peer) {
+    record(CAPTURE_OPEN, clientId, 0, peer);
+}
+
+void CaptureWriter::packetReceived(int clientId, const Packet& pkt) {
+    record(CAPTURE_FRAME, clientId, pkt.type | pkt.flags, pkt.data);
+}
+
+void CaptureWriter::packetHandled(int clientId) {
+    record(CAPTURE_DONE, clientId, 0, std::string());
+}
+
+void CaptureWriter::connectionClosed(int clientId) {
+    record(CAPTURE_CLOSE, clientId, 0, std::string());
+}
+
+void CaptureWriter::record(CaptureKind kind, int clientId, uint32_t type, const std::string& data) {
+    CaptureRecord rec;
+    rec.kind = kind;
+    rec.clientId = static_cast<uint32_t>(clientId);
+    rec.timestampNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    rec.type = type;
+    // 写线程跟不上时丢弃，不能让磁盘拖慢事件循环，也不能无限占用内存
+    size_t bytes = CAPTURE_RECORD_HEADER_SIZE + data.size();
+    if (writeFailed.load(std::memory_order_relaxed) ||
+        queuedBytes.load(std::memory_order_relaxed) + bytes > CAPTURE_QUEUE_MAX_BYTES) {
+        dropped++;
+        return;
+    }
+    rec.data = data;
+    queuedBytes.fetch_add(bytes, std::memory_order_relaxed);
+    if (!queue.tryPush(std::move(rec))) {
+        queuedBytes.fetch_sub(bytes, std::memory_order_relaxed);
+        dropped++;
+        return;
+    }
+    recorded++;
+}
+
+void CaptureWriter::appendRecord(const CaptureRecord& rec, std::string& buffer) {
+    rec.appendTo(buffer);
+    queuedBytes.fetch_sub(CAPTURE_RECORD_HEADER_SIZE + rec.data.size(), std::memory_order_relaxed);
+}
+
+void CaptureWriter::writerLoop() {
+    pinCurrentThread(writerCpus, "capture writer"); // 在分配写缓冲区之前
+    std::string buffer;
+    buffer.reserve(CAPTURE_WRITE_BUFFER + 4096);
+    CaptureRecord rec;
+    while (queue.waitPop(rec)) {
+        appendRecord(rec, buffer);
+        // 把已经排队的记录一起取出，攒成一次大的写入
+        while (buffer.size() < CAPTURE_WRITE_BUFFER && queue.tryPop(rec)) {
+            appendRecord(rec, buffer);
+        }
+        if (!writeFailed && !writeAll(buffer)) {
+            LOG(ERROR) << "Failed to write capture file: " << strerror(errno) << ". Capture stopped.";
+            writeFailed = true;
+        }
+        buffer.clear();
+    }
+}
+
+bool CaptureWriter::writeAll(const std::string& buffer) {
+    size_t written = 0;
+    while (written < buffer.size()) {
+        ssize_t n = ::write(fd, buffer.data() + written, buffer.size() - written);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        written += n;
+    }
+    return true;
+}
@@ -0,0 +1,61 @@
+// CaptureWriter.h
+// 把收到的每个数据包记录到抓包文件（格式见 Message/Capture.h），供 replay 工具重放
+//
+// - 事件循环线程只把记录放入无锁 SPSC 队列，不做任何磁盘 I/O，也从不阻塞：
+//   队列中的记录数或字节数达到上限时丢弃记录并计数（退出时输出）。每条记录最多复制 --max-frame 字节，
+//   只限制记录数的话，磁盘慢时队列可能占用数十 GB
+// - 写线程批量取出记录，攒满缓冲区或队列暂时为空时才调用一次 write
+#ifndef CAPTUREWRITER_H
+#define CAPTUREWRITER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Message/Capture.h"
+#include "Message/SpscQueue.h"
+
+#define CAPTURE_QUEUE_CAPACITY 65536   // 队列中最多等待写盘的记录数
+#define CAPTURE_QUEUE_MAX_BYTES (64 << 20) // 队列中等待写盘的记录最多占用的字节数
+#define CAPTURE_WRITE_BUFFER (256 << 10)
+
+class CaptureWriter {
+public:
+    // 创建抓包文件并启动写线程（绑定到 cpus，为空时不绑定），失败时抛出 std::runtime_error
+    CaptureWriter(const std::string& path, const std::vector<int>& cpus);
+    // 写完队列中剩余的记录后关闭文件
+    ~CaptureWriter();
+
+    CaptureWriter(const CaptureWriter&) = delete;
+    CaptureWriter& operator=(const CaptureWriter&) = delete;
+
+    // 以下只能在事件循环线程（唯一的生产者）中调用
+    void connectionOpened(int clientId, const std::string& peer);
+    void packetReceived(int clientId, const Packet& pkt);
+    void packetHandled(int clientId);
+    void connectionClosed(int clientId);
+
+    uint64_t recordedCount() const { return recorded; }
+    uint64_t droppedCount() const { return dropped; }
+
+private:
+    int fd;
+    std::chrono::steady_clock::time_point start;
+    SpscQueue<CaptureRecord> queue;
+    std::thread writerThread;
+    std::vector<int> writerCpus;
+    uint64_t recorded;
+    uint64_t dropped;
+    std::atomic<bool> writeFailed;
+    std::atomic<size_t> queuedBytes; // 生产者入队时增加，写线程取出后减少
+
+    void record(CaptureKind kind, int clientId, uint32_t type, const std::string& data);
+    // 写线程：把取出的记录追加到写缓冲区，并释放它在队列中占用的字节额度
+    void appendRecord(const CaptureRecord& rec, std::string& buffer);
+    void writerLoop();
+    bool writeAll(const std::string& buffer);
+};
+
+#endif // CAPTUREWRITER_H
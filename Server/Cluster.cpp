@@ -0,0 +1,649 @@
+// Cluster.cpp
+
+#include "Cluster.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <sstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <glog/logging.h>
+#include "Message/Scan.h"
+#include "Message/StreamChunk.h"
+#include "Message/Trace.h"
+
+#define PEER_LISTEN_BACKLOG 16
+#define PEER_BATCH_MAX_BYTES (64 << 10)     // 批量缓冲区达到该大小时立即发送
+#define PEER_FRAME_OVERHEAD 64               // 内层帧头部等额外开销（批量帧最大 = 批量阈值 + 一个最大的内层帧）
+#define PEER_FORWARD_TIMEOUT_MS 5000         // 等待对端转发结果的最长时间
+#define PEER_HELLO_TIMEOUT_MS 5000           // 等待对端 PEER_HELLO 的最长时间，超时关闭连接
+#define PEER_RECONNECT_DELAY_MS 200          // 重连间隔初始值，失败后翻倍
+#define PEER_MAX_RECONNECT_DELAY_MS 5000
+
+namespace {
+
+void setPeerSocketOptions(int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    // 已在应用层合批，不需要 Nagle 再延迟
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+// 发起非阻塞连接；连接结果由 Connection 的 EPOLLOUT/EPOLLERR 反映
+int connectNonBlocking(const PeerAddress& peer) {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(peer.port);
+    if (inet_pton(AF_INET, peer.host.c_str(), &addr.sin_addr) <= 0) {
+        LOG(ERROR) << "Invalid address for node " << peer.nodeId << ": " << peer.host;
+        return -1;
+    }
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    setPeerSocketOptions(fd);
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 && errno != EINPROGRESS) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// 目录版本从节点启动时间（微秒）开始递增，节点重启后版本仍大于旧值
+uint64_t initialDirectoryVersion() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+// "node version"
+bool parseNodeVersion(const std::string& text, int& node, uint64_t& version) {
+    std::istringstream in(text);
+    return static_cast<bool>(in >> node >> version);
+}
+
+} // namespace
+
+Cluster::Cluster(EventLoop& l, const ServerConfig& cfg, SubmitFn submitFn, ClientGoneFn goneFn, LookupFn lookupFn)
+    : loop(l), config(cfg), submit(std::move(submitFn)), gone(std::move(goneFn)), lookup(std::move(lookupFn)), listenFd(-1),
+      stopped(false), nextForwardSeq(1) {}
+
+Cluster::~Cluster() {
+    if (listenFd != -1) {
+        close(listenFd);
+    }
+}
+
+void Cluster::start() {
+    if (!enabled()) {
+        return;
+    }
+    listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listenFd < 0) {
+        throw std::runtime_error("Failed to create peer socket.");
+    }
+    int reuse = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port = htons(config.peerPort);
+    if (bind(listenFd, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+        listen(listenFd, PEER_LISTEN_BACKLOG) < 0) {
+        throw std::runtime_error("Failed to listen on peer port " + std::to_string(config.peerPort) + ".");
+    }
+    fcntl(listenFd, F_SETFL, fcntl(listenFd, F_GETFL, 0) | O_NONBLOCK);
+    loop.addFd(listenFd, EPOLLIN, this);
+
+    directory[config.nodeId].version = initialDirectoryVersion();
+    LOG(INFO) << "Cluster node " << config.nodeId << " listening for peers on port " << config.peerPort;
+
+    // 每对节点只由节点号较小的一方发起连接，避免重复连接
+    for (const PeerAddress& peer : config.peers) {
+        if (peer.nodeId > config.nodeId) {
+            spawn(connectLoop(peer));
+        }
+    }
+    scheduleGossip();
+}
+
+void Cluster::stop() {
+    stopped = true;
+    if (listenFd != -1) {
+        loop.removeFd(listenFd);
+        close(listenFd);
+        listenFd = -1;
+    }
+    for (auto& [node, link] : links) {
+        flushBatch(link);
+        link->conn->flushBlocking(PEER_FORWARD_TIMEOUT_MS);
+        link->conn->close("Server shutting down.");
+    }
+    links.clear();
+}
+
+void Cluster::onEvents(uint32_t) {
+    while (true) {
+        struct sockaddr_in addr;
+        socklen_t len = sizeof(addr);
+        int fd = accept(listenFd, (struct sockaddr*)&addr, &len);
+        if (fd < 0) {
+            return;
+        }
+        setPeerSocketOptions(fd);
+        std::string peer = std::string(inet_ntoa(addr.sin_addr)) + ":" + std::to_string(ntohs(addr.sin_port));
+        std::shared_ptr<PeerLink> link = std::make_shared<PeerLink>();
+        link->conn = std::make_shared<Connection>(loop, fd, peer);
+        link->conn->setMaxFrameSize(config.maxFrameBytes + PEER_BATCH_MAX_BYTES + PEER_FRAME_OVERHEAD);
+        link->conn->start();
+        spawn(runLink(link));
+    }
+}
+
+int Cluster::makeClientId(int localSeq) const {
+    if (!enabled()) {
+        return localSeq;
+    }
+    return config.nodeId * NODE_ID_STRIDE + localSeq % NODE_ID_STRIDE;
+}
+
+int Cluster::ownerOf(int clientId) const {
+    return enabled() ? clientId / NODE_ID_STRIDE : config.nodeId;
+}
+
+bool Cluster::isRemoteClient(int clientId) const {
+    int node = ownerOf(clientId);
+    if (node == config.nodeId) {
+        return false;
+    }
+    auto it = directory.find(node);
+    return it != directory.end() && it->second.clients.count(clientId) > 0;
+}
+
+std::vector<Cluster::RemoteClient> Cluster::remoteClients() const {
+    std::vector<RemoteClient> result;
+    for (const auto& [node, entry] : directory) {
+        if (node == config.nodeId) {
+            continue;
+        }
+        for (const auto& [id, address] : entry.clients) {
+            result.push_back(RemoteClient{id, node, address});
+        }
+    }
+    return result;
+}
+
+void Cluster::addLocalClient(int clientId, const std::string& address) {
+    if (!enabled()) {
+        return;
+    }
+    DirectoryEntry& entry = directory[config.nodeId];
+    entry.clients[clientId] = address;
+    entry.version++;
+    broadcastDelta(0, "D " + std::to_string(config.nodeId) + " " + std::to_string(entry.version) + "\n+" +
+                          std::to_string(clientId) + " " + address + "\n");
+}
+
+void Cluster::removeLocalClient(int clientId) {
+    if (!enabled()) {
+        return;
+    }
+    DirectoryEntry& entry = directory[config.nodeId];
+    if (entry.clients.erase(clientId) == 0) {
+        return;
+    }
+    entry.version++;
+    broadcastDelta(0, "D " + std::to_string(config.nodeId) + " " + std::to_string(entry.version) + "\n-" +
+                          std::to_string(clientId) + "\n");
+}
+
+Task Cluster::connectLoop(PeerAddress peer) {
+    int delayMs = PEER_RECONNECT_DELAY_MS;
+    while (!stopped) {
+        if (links.find(peer.nodeId) == links.end()) {
+            int fd = connectNonBlocking(peer);
+            if (fd >= 0) {
+                std::shared_ptr<PeerLink> link = std::make_shared<PeerLink>();
+                link->nodeId = peer.nodeId;
+                link->outbound = true;
+                link->conn = std::make_shared<Connection>(loop, fd, peer.host + ":" + std::to_string(peer.port));
+                link->conn->setMaxFrameSize(config.maxFrameBytes + PEER_BATCH_MAX_BYTES + PEER_FRAME_OVERHEAD);
+                link->conn->start();
+                co_await runLink(link);
+                if (link->registered) {
+                    delayMs = PEER_RECONNECT_DELAY_MS;
+                }
+            }
+        }
+        co_await loop.sleepFor(delayMs);
+        delayMs = std::min(delayMs * 2, PEER_MAX_RECONNECT_DELAY_MS);
+    }
+}
+
+// 一条对端连接的完整生命周期：握手、登记、逐个处理 PEER_BATCH
+Task Cluster::runLink(std::shared_ptr<PeerLink> link) {
+    Packet hello;
+    hello.type = PEER_HELLO;
+    hello.data = std::to_string(config.nodeId);
+    // 握手超时：不发 PEER_HELLO 的连接（包括未认证的入站连接）不能一直占着协程和 fd
+    std::weak_ptr<Connection> pending = link->conn;
+    EventLoop::TimerId helloTimer = loop.runAfter(PEER_HELLO_TIMEOUT_MS, [pending] {
+        if (std::shared_ptr<Connection> conn = pending.lock()) {
+            conn->close("Timed out waiting for PEER_HELLO.");
+        }
+    });
+    try {
+        if (link->outbound) {
+            link->conn->send(hello);
+        }
+        Packet reply = co_await link->conn->readPacket();
+        loop.cancelTimer(helloTimer);
+        if (reply.type != PEER_HELLO) {
+            throw std::runtime_error("Expected PEER_HELLO.");
+        }
+        int node = std::atoi(reply.data.c_str());
+        if (link->outbound && node != link->nodeId) {
+            throw std::runtime_error("Peer reports node " + reply.data + ", expected " + std::to_string(link->nodeId) + ".");
+        }
+        if (node <= 0 || node > MAX_NODE_ID || node == config.nodeId) {
+            throw std::runtime_error("Invalid peer node ID: " + reply.data);
+        }
+        if (links.find(node) != links.end()) {
+            throw std::runtime_error("Duplicate link to node " + std::to_string(node) + ".");
+        }
+        if (!link->outbound) {
+            link->conn->send(hello);
+        }
+        link->nodeId = node;
+        registerLink(link);
+
+        std::vector<FrameSpan> frames;
+        Packet inner;
+        while (!stopped) {
+            Packet batch = co_await link->conn->readPacket();
+            if (batch.type != PEER_BATCH) {
+                throw std::runtime_error("Unexpected packet type " + std::to_string(batch.type) + " on peer link.");
+            }
+            // 先找出整批的帧边界：格式错误的批次在处理任何内层数据包之前就被拒绝，也不必复制整批数据
+            frames.clear();
+            if (scanFrames(batch.data.data(), batch.data.size(), DEFAULT_MAX_FRAME_SIZE, frames) != batch.data.size()) {
+                throw std::runtime_error("Truncated PEER_BATCH.");
+            }
+            for (const FrameSpan& frame : frames) {
+                loadFrame(batch.data.data(), frame, inner);
+                if (inner.type == PEER_STREAM) {
+                    co_await deliverStream(inner); // 目标发送队列满时暂停读取这条连接
+                } else {
+                    handleInner(link, inner);
+                }
+            }
+        }
+    } catch (const std::exception& e) {
+        if (link->registered || !link->outbound) {
+            LOG(WARNING) << "Peer link " << link->conn->peerName() << " (node " << link->nodeId
+                         << ") closed: " << e.what();
+        } else {
+            LOG(WARNING) << "Failed to connect to node " << link->nodeId << " at " << link->conn->peerName()
+                         << ": " << e.what();
+        }
+    }
+    loop.cancelTimer(helloTimer);
+    unregisterLink(link);
+    link->conn->close("Peer link closed.");
+}
+
+void Cluster::registerLink(const std::shared_ptr<PeerLink>& link) {
+    links[link->nodeId] = link;
+    link->registered = true;
+    LOG(INFO) << "Peer link to node " << link->nodeId << " established (" << link->conn->peerName() << ").";
+    // 交换版本摘要，双方各自补发对方缺少的目录条目
+    sendDigest(link);
+}
+
+void Cluster::unregisterLink(const std::shared_ptr<PeerLink>& link) {
+    auto it = links.find(link->nodeId);
+    if (it == links.end() || it->second != link) {
+        return;
+    }
+    links.erase(it);
+
+    // 发往该节点、尚未收到结果的转发全部失败
+    std::vector<AsyncEvent<int>*> failed;
+    for (const auto& [seq, pending] : pendingForwards) {
+        if (pending.nodeId == link->nodeId) {
+            failed.push_back(pending.result);
+        }
+    }
+    for (AsyncEvent<int>* event : failed) {
+        event->set(FORWARD_UNREACHABLE);
+    }
+    // 该节点的客户端视为离线；节点恢复后会重新同步
+    dropNode(link->nodeId);
+}
+
+void Cluster::enqueue(const std::shared_ptr<PeerLink>& link, const Packet& inner) {
+    link->batch += inner.serialize();
+    if (link->batch.size() >= PEER_BATCH_MAX_BYTES) {
+        flushBatch(link);
+        return;
+    }
+    // 本轮事件处理中产生的所有内层数据包合成一个 PEER_BATCH
+    if (!link->flushScheduled) {
+        link->flushScheduled = true;
+        std::weak_ptr<PeerLink> weak = link;
+        loop.post([this, weak] {
+            std::shared_ptr<PeerLink> l = weak.lock();
+            if (l) {
+                l->flushScheduled = false;
+                flushBatch(l);
+            }
+        });
+    }
+}
+
+void Cluster::flushBatch(const std::shared_ptr<PeerLink>& link) {
+    if (link->batch.empty()) {
+        return;
+    }
+    Packet batch;
+    batch.type = PEER_BATCH;
+    batch.data.swap(link->batch);
+    link->conn->send(batch);
+}
+
+void Cluster::handleInner(const std::shared_ptr<PeerLink>& link, Packet& inner) {
+    switch (inner.type) {
+        case PEER_DIRECTORY:
+            handleDirectory(link, inner.data);
+            break;
+        case PEER_FORWARD:
+            handleForward(link, inner);
+            break;
+        case PEER_FORWARD_RESULT:
+            handleForwardResult(inner.data);
+            break;
+        default:
+            LOG(WARNING) << "Unknown peer message type " << inner.type << " from node " << link->nodeId;
+            break;
+    }
+}
+
+void Cluster::broadcastDelta(int fromNode, const std::string& delta) {
+    Packet inner;
+    inner.type = PEER_DIRECTORY;
+    inner.data = delta;
+    for (auto& [node, link] : links) {
+        if (node != fromNode) {
+            enqueue(link, inner);
+        }
+    }
+}
+
+// 目录消息格式（文本，每行一项）：
+//   摘要  "G\n" + "node version\n"...
+//   快照  "S node version\n" + "clientId ip:port\n"...
+//   增量  "D node version\n" + "+clientId ip:port\n" 或 "-clientId\n"
+void Cluster::handleDirectory(const std::shared_ptr<PeerLink>& link, const std::string& data) {
+    std::istringstream in(data);
+    std::string header;
+    std::string line;
+    if (!std::getline(in, header) || header.empty()) {
+        return;
+    }
+
+    if (header[0] == 'G') {
+        std::map<int, uint64_t> theirs;
+        int node;
+        uint64_t version;
+        while (std::getline(in, line)) {
+            if (parseNodeVersion(line, node, version)) {
+                theirs[node] = version;
+            }
+        }
+        for (const auto& [n, entry] : directory) {
+            auto it = theirs.find(n);
+            if (n != link->nodeId && (it == theirs.end() || it->second < entry.version)) {
+                sendSnapshot(link, n);
+            }
+        }
+        return;
+    }
+
+    int node;
+    uint64_t version;
+    if (header.size() < 2 || !parseNodeVersion(header.substr(2), node, version) || node == config.nodeId) {
+        return;
+    }
+    auto it = directory.find(node);
+
+    if (header[0] == 'S') {
+        if (it != directory.end() && it->second.version >= version) {
+            return;
+        }
+        DirectoryEntry entry;
+        entry.version = version;
+        while (std::getline(in, line)) {
+            size_t space = line.find(' ');
+            if (space != std::string::npos) {
+                entry.clients[std::atoi(line.c_str())] = line.substr(space + 1);
+            }
+        }
+        replaceEntry(node, std::move(entry));
+    } else if (header[0] == 'D') {
+        // 增量必须紧接当前版本，否则丢弃，由下一轮反熵补齐
+        if (it == directory.end() || version != it->second.version + 1) {
+            return;
+        }
+        DirectoryEntry& entry = it->second;
+        entry.version = version;
+        while (std::getline(in, line)) {
+            if (line.empty()) {
+                continue;
+            }
+            int clientId = std::atoi(line.c_str() + 1);
+            if (line[0] == '+') {
+                size_t space = line.find(' ');
+                entry.clients[clientId] = space == std::string::npos ? "" : line.substr(space + 1);
+            } else if (line[0] == '-' && entry.clients.erase(clientId) > 0) {
+                gone(clientId);
+            }
+        }
+        // 继续推送给其他节点（不回送给来源和条目所属节点）
+        Packet inner;
+        inner.type = PEER_DIRECTORY;
+        inner.data = data;
+        for (auto& [n, l] : links) {
+            if (n != link->nodeId && n != node) {
+                enqueue(l, inner);
+            }
+        }
+    }
+}
+
+void Cluster::sendDigest(const std::shared_ptr<PeerLink>& link) {
+    Packet inner;
+    inner.type = PEER_DIRECTORY;
+    inner.data = "G\n";
+    for (const auto& [node, entry] : directory) {
+        inner.data += std::to_string(node) + " " + std::to_string(entry.version) + "\n";
+    }
+    enqueue(link, inner);
+}
+
+void Cluster::sendSnapshot(const std::shared_ptr<PeerLink>& link, int node) {
+    const DirectoryEntry& entry = directory[node];
+    Packet inner;
+    inner.type = PEER_DIRECTORY;
+    inner.data = "S " + std::to_string(node) + " " + std::to_string(entry.version) + "\n";
+    for (const auto& [id, address] : entry.clients) {
+        inner.data += std::to_string(id) + " " + address + "\n";
+    }
+    enqueue(link, inner);
+}
+
+void Cluster::replaceEntry(int node, DirectoryEntry entry) {
+    auto it = directory.find(node);
+    if (it != directory.end()) {
+        for (const auto& [id, address] : it->second.clients) {
+            if (entry.clients.count(id) == 0) {
+                gone(id);
+            }
+        }
+    }
+    LOG(INFO) << "Directory: node " << node << " has " << entry.clients.size() << " clients (version "
+              << entry.version << ").";
+    directory[node] = std::move(entry);
+}
+
+void Cluster::dropNode(int node) {
+    auto it = directory.find(node);
+    if (node == config.nodeId || it == directory.end()) {
+        return;
+    }
+    for (const auto& [id, address] : it->second.clients) {
+        gone(id);
+    }
+    LOG(INFO) << "Directory: dropped node " << node << " (" << it->second.clients.size() << " clients).";
+    directory.erase(it);
+}
+
+void Cluster::scheduleGossip() {
+    loop.runAfter(config.gossipIntervalMs, [this] {
+        if (stopped) {
+            return;
+        }
+        for (auto& [node, link] : links) {
+            sendDigest(link);
+        }
+        scheduleGossip();
+    });
+}
+
+Task Cluster::forward(int sender, int target, Packet message, ForwardResult& result) {
+    int node = ownerOf(target);
+    if (!isRemoteClient(target)) {
+        result = FORWARD_NOT_FOUND;
+        co_return;
+    }
+    auto linkIt = links.find(node);
+    if (linkIt == links.end()) {
+        result = FORWARD_UNREACHABLE;
+        co_return;
+    }
+    std::shared_ptr<PeerLink> link = linkIt->second;
+    // 节点间连接的发送队列满时只挂起当前会话
+    bool writable = co_await link->conn->writable();
+    if (!writable || link->conn->isClosed()) {
+        result = FORWARD_UNREACHABLE;
+        co_return;
+    }
+
+    uint64_t seq = nextForwardSeq++;
+    AsyncEvent<int> done(loop);
+    pendingForwards[seq] = PendingForward{node, &done};
+    Packet inner;
+    inner.type = PEER_FORWARD;
+    inner.flags = message.flags; // 消息的压缩和追踪标志
+    inner.trace = std::move(message.trace);
+    inner.data = std::to_string(seq) + ":" + std::to_string(sender) + ":" + std::to_string(target) + ":" + message.data;
+    enqueue(link, inner);
+
+    std::optional<int> code = co_await done.wait(PEER_FORWARD_TIMEOUT_MS);
+    pendingForwards.erase(seq);
+    result = code ? static_cast<ForwardResult>(*code) : FORWARD_UNREACHABLE;
+}
+
+void Cluster::handleForward(const std::shared_ptr<PeerLink>& link, const Packet& inner) {
+    // "seq:senderId:targetId:message"，数据包标志属于 message
+    const std::string& data = inner.data;
+    size_t first = data.find(':');
+    size_t second = first == std::string::npos ? first : data.find(':', first + 1);
+    size_t third = second == std::string::npos ? second : data.find(':', second + 1);
+    if (third == std::string::npos) {
+        LOG(WARNING) << "Malformed PEER_FORWARD from node " << link->nodeId;
+        return;
+    }
+    std::string seq = data.substr(0, first);
+    int sender = std::atoi(data.c_str() + first + 1);
+    int target = std::atoi(data.c_str() + second + 1);
+
+    ForwardResult result = FORWARD_NOT_FOUND;
+    if (ownerOf(target) == config.nodeId) {
+        Packet message;
+        message.type = SEND_MESSAGE;
+        message.flags = inner.flags;
+        message.trace = inner.trace;
+        message.data = data.substr(third + 1);
+        traceStamp(message, TRACE_PEER_RECV);
+        result = submit(sender, target, std::move(message));
+    }
+    Packet reply;
+    reply.type = PEER_FORWARD_RESULT;
+    reply.data = seq + ":" + std::to_string(result);
+    enqueue(link, reply);
+}
+
+void Cluster::handleForwardResult(const std::string& data) {
+    // "seq:code"
+    size_t colon = data.find(':');
+    if (colon == std::string::npos) {
+        return;
+    }
+    uint64_t seq = std::strtoull(data.c_str(), nullptr, 10);
+    auto it = pendingForwards.find(seq);
+    if (it != pendingForwards.end()) {
+        it->second.result->set(std::atoi(data.c_str() + colon + 1));
+    }
+}
+
+Task Cluster::forwardStream(int sender, int target, const std::string& chunk, bool& delivered) {
+    delivered = false;
+    auto linkIt = links.find(ownerOf(target));
+    if (!isRemoteClient(target) || linkIt == links.end()) {
+        co_return;
+    }
+    std::shared_ptr<PeerLink> link = linkIt->second;
+    bool writable = co_await link->conn->writable();
+    if (!writable || link->conn->isClosed()) {
+        co_return;
+    }
+    Packet inner;
+    inner.type = PEER_STREAM;
+    inner.data.reserve(4 + chunk.size());
+    StreamChunk::appendU32(inner.data, static_cast<uint32_t>(sender));
+    inner.data.append(chunk);
+    enqueue(link, inner);
+    delivered = true;
+}
+
+Task Cluster::deliverStream(Packet& inner) {
+    // [发送方ID(4)] + STREAM_CHUNK 的数据（对端ID为接收方）
+    if (inner.data.size() < 4 + STREAM_HEADER_SIZE) {
+        co_return;
+    }
+    uint32_t sender = StreamChunk::readU32(inner.data, 0);
+    inner.data.erase(0, 4);
+    int target = static_cast<int>(StreamChunk::readU32(inner.data, 0));
+    std::shared_ptr<Connection> conn = lookup(target);
+    if (!conn) {
+        LOG(WARNING) << "Dropped stream chunk from Client " << sender << ": Client " << target << " not found.";
+        co_return;
+    }
+    bool writable = co_await conn->writable();
+    if (writable) {
+        StreamChunk::writeU32(inner.data, 0, sender);
+        inner.type = STREAM_CHUNK;
+        conn->send(inner);
+    }
+}
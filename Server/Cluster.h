@@ -0,0 +1,137 @@
+// Cluster.h
+// 多节点集群：节点之间建立对端连接（peer link），同步客户端目录并跨节点转发 SEND_MESSAGE
+//
+// - 客户端 ID 中编码了所属节点（见 NODE_ID_STRIDE），目录记录每个节点上的在线客户端
+// - 目录按节点分条目，每个条目带版本号（节点启动时间 + 变更次数，重启后版本仍然更大）：
+//   本地变更立即以增量推送给所有对端，收到的新增量再转推给其他对端；
+//   另外每隔 gossipIntervalMs 交换版本摘要，落后的一方收到完整快照（反熵）
+// - 节点之间的内层数据包先写入每条连接的批量缓冲区，在本轮事件处理结束时合成一个 PEER_BATCH 发送；
+//   跨节点转发带序号，不等待上一条的结果即可继续发送（流水线），结果按序号匹配
+#ifndef CLUSTER_H
+#define CLUSTER_H
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "AsyncEvent.h"
+#include "Connection.h"
+#include "EventLoop.h"
+#include "ServerConfig.h"
+#include "Task.h"
+
+// 转发结果，同时用作 PEER_FORWARD_RESULT 中的结果码
+enum ForwardResult {
+    FORWARD_SENT = 0,        // 已投递给接收方
+    FORWARD_QUEUED = 1,      // 信用不足，在接收方所在节点排队
+    FORWARD_REJECTED = 2,    // 排队已满（背压）
+    FORWARD_NOT_FOUND = 3,   // 目标客户端不存在
+    FORWARD_UNREACHABLE = 4  // 目标所在节点无连接或未及时回复
+};
+
+class Cluster : public EventHandler {
+public:
+    // 把发给本节点客户端的消息（SEND_MESSAGE 数据包）交给本地投递（信用流控）
+    typedef std::function<ForwardResult(int sender, int receiver, Packet&& message)> SubmitFn;
+    // 远程客户端已离线（用于清理与其相关的流控状态）
+    typedef std::function<void(int clientId)> ClientGoneFn;
+    // 查找本节点客户端的连接（投递其他节点转发来的流分块），不存在时返回 nullptr
+    typedef std::function<std::shared_ptr<Connection>(int clientId)> LookupFn;
+
+    struct RemoteClient {
+        int clientId;
+        int nodeId;
+        std::string address; // 客户端的 IP:Port
+    };
+
+    Cluster(EventLoop& loop, const ServerConfig& config, SubmitFn submit, ClientGoneFn gone, LookupFn lookup);
+    ~Cluster();
+
+    Cluster(const Cluster&) = delete;
+    Cluster& operator=(const Cluster&) = delete;
+
+    bool enabled() const { return config.nodeId != 0; }
+    int nodeId() const { return config.nodeId; }
+
+    // 监听对端端口并开始连接其他节点；监听失败时抛出 std::runtime_error
+    void start();
+    // 关闭所有对端连接
+    void stop();
+
+    // 由节点内序号生成全局唯一的客户端 ID
+    int makeClientId(int localSeq) const;
+    // 客户端所属的节点（单机模式下总是本节点）
+    int ownerOf(int clientId) const;
+    // 目录中是否有该远程客户端
+    bool isRemoteClient(int clientId) const;
+
+    void addLocalClient(int clientId, const std::string& address);
+    void removeLocalClient(int clientId);
+    std::vector<RemoteClient> remoteClients() const;
+
+    // co_await cluster.forward(...)：把消息转发给其他节点上的客户端，结果写入 result。
+    // 共享字典压缩的消息原样转发，由目标节点决定是否需要解压
+    Task forward(int sender, int target, Packet message, ForwardResult& result);
+    // co_await cluster.forwardStream(...)：把 STREAM_CHUNK 的数据转给其他节点上的客户端（不等待结果）
+    Task forwardStream(int sender, int target, const std::string& chunk, bool& delivered);
+
+    void onEvents(uint32_t events) override; // 对端监听 socket 可读
+
+private:
+    struct PeerLink {
+        int nodeId = 0;   // 握手完成前为 0
+        bool outbound = false;
+        bool registered = false; // 握手成功并曾登记到 links
+        std::shared_ptr<Connection> conn;
+        std::string batch; // 尚未发送的内层数据包
+        bool flushScheduled = false;
+    };
+    struct DirectoryEntry {
+        uint64_t version = 0;
+        std::map<int, std::string> clients; // 客户端 ID -> IP:Port
+    };
+    struct PendingForward {
+        int nodeId;
+        AsyncEvent<int>* result;
+    };
+
+    EventLoop& loop;
+    const ServerConfig& config;
+    SubmitFn submit;
+    ClientGoneFn gone;
+    LookupFn lookup;
+    int listenFd;
+    bool stopped;
+
+    std::unordered_map<int, std::shared_ptr<PeerLink>> links; // 节点号 -> 已握手的连接
+    std::map<int, DirectoryEntry> directory;                  // 节点号 -> 该节点的客户端
+    std::unordered_map<uint64_t, PendingForward> pendingForwards;
+    uint64_t nextForwardSeq;
+
+    Task connectLoop(PeerAddress peer);
+    Task runLink(std::shared_ptr<PeerLink> link);
+    void registerLink(const std::shared_ptr<PeerLink>& link);
+    void unregisterLink(const std::shared_ptr<PeerLink>& link);
+
+    void enqueue(const std::shared_ptr<PeerLink>& link, const Packet& inner);
+    void flushBatch(const std::shared_ptr<PeerLink>& link);
+    void handleInner(const std::shared_ptr<PeerLink>& link, Packet& inner);
+
+    // 目录同步
+    void broadcastDelta(int fromNode, const std::string& delta);
+    void handleDirectory(const std::shared_ptr<PeerLink>& link, const std::string& data);
+    void sendDigest(const std::shared_ptr<PeerLink>& link);
+    void sendSnapshot(const std::shared_ptr<PeerLink>& link, int node);
+    void replaceEntry(int node, DirectoryEntry entry);
+    void dropNode(int node);
+    void scheduleGossip();
+
+    void handleForward(const std::shared_ptr<PeerLink>& link, const Packet& inner);
+    void handleForwardResult(const std::string& data);
+    Task deliverStream(Packet& inner);
+};
+
+#endif // CLUSTER_H
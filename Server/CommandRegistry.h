@@ -0,0 +1,53 @@
+// CommandRegistry.h
+// 按消息类型注册协程处理函数
+#ifndef COMMANDREGISTRY_H
+#define COMMANDREGISTRY_H
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include "Task.h"
+#include "Connection.h"
+#include "RateLimiter.h"
+
+// 一个客户端连接的会话信息，在整个连接生命周期内有效
+struct Session {
+    int clientId;
+    std::shared_ptr<Connection> conn;
+    std::string clientIp;
+    int clientPort;
+    std::shared_ptr<ConnectionRateState> rate; // 本连接的限流状态
+    std::string trace; // 正在处理的请求带有的追踪时间戳（未开启追踪时为空），响应和转发的消息沿用
+};
+
+// 处理函数：可以 co_await 读包、发送队列空间、定时器以及其他客户端的回复。
+// 同一连接上的命令按顺序处理（响应顺序与请求一致），不同连接之间并发执行。
+// 注意：处理函数的引用参数在其结束前保持有效，但不要使用带捕获的 lambda 协程。
+typedef std::function<Task(Session&, Packet&)> CommandHandler;
+
+class CommandRegistry {
+private:
+    std::unordered_map<uint32_t, CommandHandler> handlers;
+    CommandHandler fallback;
+
+public:
+    void on(MessageType type, CommandHandler handler) {
+        handlers[type] = std::move(handler);
+    }
+
+    // 未注册类型的处理函数
+    void otherwise(CommandHandler handler) {
+        fallback = std::move(handler);
+    }
+
+    Task dispatch(Session& session, Packet& pkt) const {
+        auto it = handlers.find(pkt.type);
+        if (it != handlers.end()) {
+            return it->second(session, pkt);
+        }
+        return fallback(session, pkt);
+    }
+};
+
+#endif // COMMANDREGISTRY_H
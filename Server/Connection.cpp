@@ -0,0 +1,524 @@
+// Connection.cpp
+
+#include "Connection.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h> // splice, pipe2
+#include <netinet/in.h>
+#include <netinet/tcp.h> // TCP_NOTSENT_LOWAT
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <utility>
+#include <glog/logging.h>
+
+#define READ_CHUNK_SIZE 65536
+
+Connection::Connection(EventLoop& l, int socketFd, const std::string& peerName)
+    : loop(l), fd(socketFd), peer(peerName), maxFrameSize(DEFAULT_MAX_FRAME_SIZE), laneWeights{{1, 1, 1}},
+      fragmentsEnabled(false), queuedBytes(0), outPos(0), readPaused(false), wantWrite(false),
+      peerEof(false), closed(false), closing(false), hasPending(false), bytesDecoded(0), skipBytes(0) {}
+
+Connection::~Connection() {
+    if (fd != -1) {
+        ::close(fd);
+    }
+}
+
+void Connection::start() {
+    selfRef = shared_from_this();
+    // 数据一旦进入内核发送缓冲区就无法再被高优先级车道插队：限制其中未发出的部分
+    int lowat = OUTBOUND_NOTSENT_LOWAT;
+    setsockopt(fd, IPPROTO_TCP, TCP_NOTSENT_LOWAT, &lowat, sizeof(lowat));
+    loop.addFd(fd, EPOLLIN, this);
+}
+
+bool Connection::tryDecode() {
+    if (!hasPending && !closed) {
+        try {
+            hasPending = decoder.next(pending);
+            if (hasPending) {
+                // 丢弃该帧之前的读取记录；第一个覆盖到帧末尾的读取就是收齐该帧的那一次
+                uint64_t frameEnd = bytesDecoded - decoder.bufferedBytes();
+                while (!readTimes.empty() && readTimes.front().first < frameEnd) {
+                    readTimes.pop_front();
+                }
+                if ((pending.flags & PACKET_FLAG_TRACE) && !readTimes.empty()) {
+                    traceStamp(pending, TRACE_SERVER_RECV, readTimes.front().second);
+                }
+            }
+            if (hasPending && pending.flags != 0) {
+                if ((pending.flags & PACKET_FLAG_ZDICT) && !codec.enabled()) {
+                    throw std::runtime_error("Dictionary-compressed packet without negotiated compression.");
+                }
+                codec.decode(pending, maxFrameSize, pending.type == SEND_MESSAGE);
+            }
+        } catch (const std::exception& e) {
+            hasPending = false;
+            close(e.what());
+        }
+        // 处理函数取走数据后恢复读取
+        if (readPaused && decoder.bufferedBytes() < MAX_INPUT_BUFFER) {
+            readPaused = false;
+            updateInterest();
+        }
+    }
+    return hasPending;
+}
+
+bool Connection::ReadAwaiter::await_ready() {
+    return conn.tryDecode() || conn.closed || conn.peerEof;
+}
+
+void Connection::ReadAwaiter::await_suspend(std::coroutine_handle<> h) {
+    conn.readWaiter = h;
+}
+
+Packet Connection::ReadAwaiter::await_resume() {
+    if (conn.tryDecode()) {
+        conn.hasPending = false;
+        return std::move(conn.pending);
+    }
+    if (conn.closed) {
+        throw std::runtime_error(conn.closeReason);
+    }
+    throw std::runtime_error("Connection closed by peer.");
+}
+
+void Connection::onEvents(uint32_t events) {
+    if (closed) {
+        return;
+    }
+    if (events & EPOLLERR) {
+        int err = 0;
+        socklen_t len = sizeof(err);
+        getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len);
+        close(err ? strerror(err) : "Socket error.");
+        return;
+    }
+    if (events & (EPOLLIN | EPOLLHUP)) {
+        if (relayOut) {
+            pumpRelay(relayOut);
+        } else {
+            handleReadable();
+        }
+    }
+    if (!closed && (events & EPOLLHUP)) {
+        close("Connection closed by peer.");
+        return;
+    }
+    if (!closed && (events & EPOLLOUT)) {
+        if (relayIn) {
+            pumpRelay(relayIn);
+        } else {
+            flush();
+        }
+    }
+}
+
+void Connection::handleReadable() {
+    char buffer[READ_CHUNK_SIZE];
+    while (!closed && !readPaused && !peerEof && !relayOut) {
+        ssize_t bytes = recv(fd, buffer, skipBytes > 0 ? std::min(sizeof(buffer), skipBytes) : sizeof(buffer), 0);
+        if (bytes > 0 && skipBytes > 0) {
+            skipBytes -= bytes;
+        } else if (bytes > 0) {
+            decoder.append(buffer, bytes);
+            bytesDecoded += bytes;
+            readTimes.emplace_back(bytesDecoded, traceNowNs());
+            if (spliceRouter && trySplice()) {
+                pumpRelay(relayOut);
+                return;
+            }
+            if (decoder.bufferedBytes() >= MAX_INPUT_BUFFER) {
+                // 处理函数跟不上：暂停读取，让 TCP 窗口把压力传回发送方
+                readPaused = true;
+                updateInterest();
+            }
+        } else if (bytes == 0) {
+            peerEof = true;
+            updateInterest();
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            break;
+        } else if (errno != EINTR) {
+            close(strerror(errno));
+            return;
+        }
+    }
+    if (readWaiter && (tryDecode() || closed || peerEof)) {
+        wakeReader();
+    }
+}
+
+OutboundLane Connection::laneFor(MessageType type) {
+    switch (type) {
+    case DISCONNECT:
+        return LANE_CONTROL;
+    case SEND_MESSAGE:
+    case STREAM_CHUNK:
+        return LANE_BULK;
+    default:
+        return LANE_RESPONSE;
+    }
+}
+
+bool Connection::send(const Packet& pkt) {
+    if (closed || closing) {
+        return false;
+    }
+    Lane& lane = lanes[laneFor(pkt.type)];
+    lane.packets.push_back(pkt);
+    traceStamp(lane.packets.back(), TRACE_SERVER_ENQUEUE);
+    queuedBytes += pkt.data.size() + 8;
+    // 作为 splice 目标期间，新数据排在正在转发的帧之后，转发完成后再发送
+    if (!wantWrite && !relayIn) {
+        flush();
+    }
+    return !closed;
+}
+
+bool Connection::encodePacket(const Packet& pkt, Packet& out) {
+    try {
+        return codec.encode(pkt, out, maxFrameSize); // 解开的数据也受本连接的帧上限约束，车道中的内存保持有界
+    } catch (const std::exception& e) {
+        // 发送方给出了无法解开的共享字典压缩数据：对端仍会收到一个空的数据包（保持信用流控的计数）
+        LOG(WARNING) << "Failed to decode relayed packet for " << peer << ": " << e.what();
+        out.type = pkt.type;
+        out.flags = 0;
+        out.data.clear();
+        return true;
+    }
+}
+
+// 加权轮询（按字节计的 deficit round robin）：每轮每个非空车道获得 权重 * FRAGMENT_BYTES 的额度，
+// 取出的帧追加到 outBuffer，直到攒够 OUTBOUND_BATCH_BYTES 或车道全空。压缩在取出时进行，
+// 保证流式压缩的顺序与线路上的顺序一致
+void Connection::schedule() {
+    while (outBuffer.size() < OUTBOUND_BATCH_BYTES && queuedBytes > 0) {
+        for (int i = 0; i < LANE_COUNT; i++) {
+            Lane& lane = lanes[i];
+            if (lane.packets.empty()) {
+                lane.deficit = 0;
+                continue;
+            }
+            lane.deficit += static_cast<int64_t>(laneWeights[i]) * FRAGMENT_BYTES;
+            while (!lane.packets.empty() && lane.deficit > 0) {
+                lane.deficit -= takeFrame(lane, i == LANE_BULK && fragmentsEnabled);
+            }
+        }
+    }
+}
+
+// 取出车道队首的一帧（split 时大数据包每次只取一个分片），返回其数据字节数
+size_t Connection::takeFrame(Lane& lane, bool split) {
+    Packet& front = lane.packets.front();
+    Packet encoded;
+    if (split && lane.offset == 0 && front.data.size() > FRAGMENT_BYTES && (front.flags & PACKET_FLAG_ZDICT) &&
+        encodePacket(front, encoded)) {
+        // 对端未协商压缩：先整体解开共享字典压缩，再分片
+        queuedBytes = queuedBytes - front.data.size() + encoded.data.size();
+        front = std::move(encoded);
+    }
+    size_t remaining = front.data.size() - lane.offset;
+    if (!split || (lane.offset == 0 && remaining <= FRAGMENT_BYTES)) {
+        traceStamp(front, TRACE_SERVER_FLUSH);
+        outBuffer += encodePacket(front, encoded) ? encoded.serialize() : front.serialize();
+        queuedBytes -= remaining + 8;
+        lane.packets.pop_front();
+        return remaining;
+    }
+
+    Packet fragment;
+    fragment.type = front.type;
+    fragment.flags = front.flags & ~PACKET_FLAG_TRACE;
+    size_t size = std::min<size_t>(remaining, FRAGMENT_BYTES);
+    fragment.data.assign(front.data, lane.offset, size);
+    lane.offset += size;
+    bool last = lane.offset == front.data.size();
+    if (last && (front.flags & PACKET_FLAG_TRACE)) {
+        // 追踪时间戳只随最后一个分片发送
+        fragment.flags |= PACKET_FLAG_TRACE;
+        fragment.trace = std::move(front.trace);
+        traceStamp(fragment, TRACE_SERVER_FLUSH);
+    }
+    Packet& out = encodePacket(fragment, encoded) ? encoded : fragment;
+    out.flags |= last ? PACKET_FLAG_LAST : PACKET_FLAG_MORE;
+    outBuffer += out.serialize();
+    queuedBytes -= last ? size + 8 : size;
+    if (last) {
+        lane.packets.pop_front();
+        lane.offset = 0;
+    }
+    return size;
+}
+
+void Connection::flush() {
+    while (true) {
+        if (outPos == outBuffer.size()) {
+            outBuffer.clear();
+            outPos = 0;
+            schedule();
+            if (outBuffer.empty()) {
+                break;
+            }
+        }
+        ssize_t sent = ::send(fd, outBuffer.data() + outPos, outBuffer.size() - outPos, MSG_NOSIGNAL);
+        if (sent > 0) {
+            outPos += sent;
+        } else if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        } else if (sent < 0 && errno == EINTR) {
+            continue;
+        } else {
+            close("Failed to send data.");
+            return;
+        }
+    }
+    if (closing && outboundBytes() == 0) {
+        close("Closed after flush.");
+        return;
+    }
+    wantWrite = outboundBytes() > 0;
+    updateInterest();
+    if (outboundBytes() < OUTBOUND_LOW_WATERMARK) {
+        wakeWriters();
+    }
+}
+
+void Connection::updateInterest() {
+    if (closed) {
+        return;
+    }
+    uint32_t events = 0;
+    if (relayOut) {
+        // 管道排空后才继续从 socket 读，此时 splice 返回 EAGAIN 一定表示 socket 暂无数据
+        if (relayOut->remaining > 0 && relayOut->inPipe == 0) {
+            events |= EPOLLIN;
+        }
+    } else if (!readPaused && !peerEof) {
+        events |= EPOLLIN;
+    }
+    if (relayIn ? (relayIn->headPos < relayIn->head.size() || relayIn->inPipe > 0) : wantWrite) {
+        events |= EPOLLOUT;
+    }
+    loop.modifyFd(fd, events, this);
+}
+
+void Connection::close(const std::string& reason) {
+    if (closed) {
+        return;
+    }
+    closed = true;
+    closeReason = reason;
+    if (relayOut) {
+        finishRelay(relayOut, RELAY_SOURCE_FAILED);
+    }
+    if (relayIn) {
+        finishRelay(relayIn, RELAY_TARGET_FAILED);
+    }
+    loop.removeFd(fd);
+    ::close(fd);
+    fd = -1;
+    wakeReader();
+    wakeWriters();
+    // 延迟释放自身引用：当前可能正处于本对象的成员函数中
+    std::shared_ptr<Connection> self = std::move(selfRef);
+    loop.post([self] {});
+}
+
+void Connection::closeAfterFlush() {
+    if (outboundBytes() == 0) {
+        close("Closed after flush.");
+    } else {
+        closing = true;
+    }
+}
+
+void Connection::flushBlocking(int timeoutMs) {
+    if (closed || outboundBytes() == 0) {
+        return;
+    }
+    int flags = fcntl(fd, F_GETFL, 0);
+    fcntl(fd, F_SETFL, flags & ~O_NONBLOCK);
+    struct timeval tv;
+    tv.tv_sec = timeoutMs / 1000;
+    tv.tv_usec = (timeoutMs % 1000) * 1000;
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    // 仍按车道顺序发送：退出通知（控制车道）先于排队的批量消息
+    while (true) {
+        if (outPos == outBuffer.size()) {
+            outBuffer.clear();
+            outPos = 0;
+            schedule();
+            if (outBuffer.empty()) {
+                break;
+            }
+        }
+        ssize_t sent = ::send(fd, outBuffer.data() + outPos, outBuffer.size() - outPos, MSG_NOSIGNAL);
+        if (sent <= 0) {
+            break;
+        }
+        outPos += sent;
+    }
+    outBuffer.clear();
+    outPos = 0;
+    for (Lane& lane : lanes) {
+        lane.packets.clear();
+        lane.offset = 0;
+    }
+    queuedBytes = 0;
+}
+
+void Connection::wakeReader() {
+    if (readWaiter) {
+        loop.schedule(std::exchange(readWaiter, nullptr));
+    }
+}
+
+void Connection::wakeWriters() {
+    std::vector<std::coroutine_handle<>> waiters;
+    waiters.swap(writeWaiters);
+    for (auto h : waiters) {
+        loop.schedule(h);
+    }
+}
+
+bool Connection::trySplice() {
+    // 读协程必须正在等待下一个数据包，否则之前的数据包还没处理完，直接转发会打乱顺序
+    if (relayOut || !readWaiter || hasPending) {
+        return false;
+    }
+    uint32_t length;
+    uint32_t type;
+    try {
+        if (!decoder.peekHeader(length, type)) {
+            return false;
+        }
+    } catch (const std::exception&) {
+        return false; // 由 tryDecode 报告并关闭连接
+    }
+    size_t buffered = decoder.bufferedBytes();
+    if (buffered >= length || length - buffered < SPLICE_MIN_BYTES) {
+        return false;
+    }
+
+    // 先创建管道：router 一旦返回目标就已经改写了 head，之后不能再失败（fd 紧张时 pipe2 可能返回 EMFILE）
+    std::shared_ptr<SpliceRelay> relay = std::make_shared<SpliceRelay>();
+    if (pipe2(relay->pipeFds, O_NONBLOCK | O_CLOEXEC) < 0) {
+        return false;
+    }
+    decoder.takeBuffered(relay->head);
+    std::shared_ptr<Connection> target = spliceRouter(relay->head, length, relay->abortPacket);
+    if (!target) {
+        decoder.append(relay->head.data(), relay->head.size()); // 不转发：放回解码器
+        ::close(relay->pipeFds[0]);
+        ::close(relay->pipeFds[1]);
+        return false;
+    }
+    int capacity = fcntl(relay->pipeFds[1], F_SETPIPE_SZ, SPLICE_PIPE_SIZE);
+    if (capacity <= 0) {
+        capacity = fcntl(relay->pipeFds[1], F_GETPIPE_SZ);
+    }
+    relay->pipeCapacity = capacity > 0 ? capacity : 65536;
+    relay->source = shared_from_this();
+    relay->target = target;
+    relay->headPos = 0;
+    relay->remaining = length - buffered;
+    relay->inPipe = 0;
+    relayOut = relay;
+    target->relayIn = relay;
+    return true;
+}
+
+void Connection::pumpRelay(std::shared_ptr<SpliceRelay> relay) {
+    Connection& src = *relay->source;
+    Connection& dst = *relay->target;
+    bool progress = true;
+    while (progress) {
+        progress = false;
+        // 1. 帧开头
+        while (relay->headPos < relay->head.size()) {
+            ssize_t sent = ::send(dst.fd, relay->head.data() + relay->headPos,
+                                  relay->head.size() - relay->headPos, MSG_NOSIGNAL);
+            if (sent > 0) {
+                relay->headPos += sent;
+                progress = true;
+            } else if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                break;
+            } else if (sent < 0 && errno == EINTR) {
+                continue;
+            } else {
+                finishRelay(relay, RELAY_TARGET_FAILED);
+                dst.close("Failed to send data.");
+                return;
+            }
+        }
+        // 2. 源 socket -> 管道（管道为空时才读）
+        if (relay->remaining > 0 && relay->inPipe == 0) {
+            ssize_t moved = splice(src.fd, nullptr, relay->pipeFds[1], nullptr,
+                                   std::min(relay->remaining, relay->pipeCapacity), SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            if (moved > 0) {
+                relay->remaining -= moved;
+                relay->inPipe += moved;
+                progress = true;
+            } else if (moved == 0 || (errno != EAGAIN && errno != EINTR)) {
+                std::string reason = moved == 0 ? "Connection closed by peer." : strerror(errno);
+                finishRelay(relay, RELAY_SOURCE_FAILED);
+                src.close(reason);
+                return;
+            }
+        }
+        // 3. 管道 -> 目标 socket（帧开头发完之后）
+        if (relay->headPos == relay->head.size() && relay->inPipe > 0) {
+            ssize_t moved = splice(relay->pipeFds[0], nullptr, dst.fd, nullptr,
+                                   relay->inPipe, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            if (moved > 0) {
+                relay->inPipe -= moved;
+                progress = true;
+            } else if (moved == 0 || (errno != EAGAIN && errno != EINTR)) {
+                finishRelay(relay, RELAY_TARGET_FAILED);
+                dst.close("Failed to send data.");
+                return;
+            }
+        }
+        if (relay->headPos == relay->head.size() && relay->remaining == 0 && relay->inPipe == 0) {
+            finishRelay(relay, RELAY_DONE);
+            return;
+        }
+    }
+    src.updateInterest();
+    dst.updateInterest();
+}
+
+void Connection::finishRelay(const std::shared_ptr<SpliceRelay>& relay, RelayEnd end) {
+    std::shared_ptr<Connection> src = relay->source;
+    std::shared_ptr<Connection> dst = relay->target;
+    ::close(relay->pipeFds[0]);
+    ::close(relay->pipeFds[1]);
+    src->relayOut.reset();
+    dst->relayIn.reset();
+
+    if (end == RELAY_SOURCE_FAILED && !dst->closed) {
+        // 目标已收到半帧：补齐（未发出的开头 + 管道中及未读取的字节填 0），再通知其中止，保持帧边界
+        std::string rest = relay->head.substr(relay->headPos);
+        rest.append(relay->inPipe + relay->remaining, '\0');
+        rest += relay->abortPacket.serialize();
+        dst->outBuffer.insert(dst->outPos, rest);
+    } else if (end == RELAY_TARGET_FAILED && !src->closed) {
+        // 源连接继续工作：丢弃这一帧尚未读取的部分
+        src->skipBytes = relay->remaining;
+    }
+
+    if (!src->closed) {
+        src->updateInterest();
+    }
+    if (!dst->closed) {
+        dst->flush();
+    }
+    if (end != RELAY_DONE) {
+        LOG(WARNING) << "Splice relay from " << src->peer << " to " << dst->peer
+                     << (end == RELAY_SOURCE_FAILED ? " aborted by source." : " aborted by target.");
+    }
+}
@@ -0,0 +1,179 @@
+// Connection.h
+// 服务器端的非阻塞客户端连接，提供供协程 co_await 的读/写接口
+#ifndef CONNECTION_H
+#define CONNECTION_H
+
+#include <array>
+#include <coroutine>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "EventLoop.h"
+#include "Message/MySocket.h"
+#include "Message/FrameDecoder.h"
+#include "Message/Compression.h"
+#include "Message/Fragment.h"
+#include "Message/Trace.h"
+
+#define MAX_INPUT_BUFFER (1 << 20)        // 处理函数忙时最多预读的字节数，超过后暂停读取
+#define OUTBOUND_HIGH_WATERMARK (4 << 20) // 发送队列超过该值时 writable() 挂起
+#define OUTBOUND_LOW_WATERMARK (1 << 20)  // 发送队列降到该值以下时恢复等待者
+#define SPLICE_MIN_BYTES (64 << 10)       // 帧的未读部分至少这么大时才考虑 splice 转发
+#define SPLICE_PIPE_SIZE (1 << 20)        // splice 中转管道的容量
+#define OUTBOUND_BATCH_BYTES (64 << 10)   // 每次从各车道取出、合并写入 socket 的字节数（取出后不能再被插队）
+#define OUTBOUND_NOTSENT_LOWAT (128 << 10) // 内核中未发出的数据超过该值时不再接受写入，其余留在车道中等待调度
+
+// 发送队列的车道：数据包按类型进入不同车道，车道之间按权重轮流发送，车道内保持先后顺序
+enum OutboundLane {
+    LANE_CONTROL,  // DISCONNECT 等控制消息
+    LANE_RESPONSE, // 请求的响应（客户端按顺序匹配，必须在同一车道），以及集群链路上的所有数据包
+    LANE_BULK,     // 转发的消息和流分块
+    LANE_COUNT
+};
+
+class Connection;
+
+// 把一帧的剩余部分从源连接经管道直接转给目标连接（socket -> pipe -> socket，不经过用户态缓冲区）
+struct SpliceRelay {
+    std::shared_ptr<Connection> source;
+    std::shared_ptr<Connection> target;
+    int pipeFds[2];
+    size_t pipeCapacity;
+    std::string head;    // 已在用户态的帧开头，先于管道数据写给目标
+    size_t headPos;
+    size_t remaining;    // 还需从源 socket 读取的字节数
+    size_t inPipe;       // 已在管道中、尚未写给目标的字节数
+    Packet abortPacket;  // 源连接中途断开时，补齐该帧后发给目标的数据包
+};
+
+class Connection : public EventHandler, public std::enable_shared_from_this<Connection> {
+public:
+    Connection(EventLoop& loop, int fd, const std::string& peer);
+    ~Connection();
+
+    Connection(const Connection&) = delete;
+    Connection& operator=(const Connection&) = delete;
+
+    // 注册到事件循环，开始接收数据
+    void start();
+
+    // 单个数据包数据部分的上限，超过时关闭连接（不会为其分配内存）
+    void setMaxFrameSize(size_t maxDataSize) {
+        maxFrameSize = maxDataSize;
+        decoder.setMaxFrameSize(maxDataSize);
+    }
+
+    // 压缩协商成功后调用：之后发送的、不少于 minBytes 的数据包用本连接的流式上下文压缩。
+    // 收到的压缩数据包总是在交给读协程前解开（SEND_MESSAGE 的共享字典压缩保留，供原样转发）
+    void enableCompression(size_t minBytes) { codec.enable(minBytes); }
+    bool compressionEnabled() const { return codec.enabled(); }
+
+    // 各车道每轮可发送的字节数为 权重 * FRAGMENT_BYTES
+    void setLaneWeights(const std::array<uint32_t, LANE_COUNT>& weights) { laneWeights = weights; }
+    // 对端能够重组分片（HELLO 协商）：之后批量车道中的大数据包拆成 FRAGMENT_BYTES 的分片发送
+    void enableFragments() { fragmentsEnabled = true; }
+
+    // splice 转发：读协程空闲、解码器中只有一帧的开头而其余部分（至少 SPLICE_MIN_BYTES）还在 socket 中时，
+    // 由 router 决定是否把这一帧直接转给另一个连接。router 在其他条件都满足后最后调用，
+    // 返回目标连接时即确定转发，可以改写 head（已收到的帧开头）并填写 abortPacket；
+    // 返回 nullptr 表示照常读入内存交给读协程，此时不得改写 head
+    typedef std::function<std::shared_ptr<Connection>(std::string& head, uint32_t frameLength, Packet& abortPacket)> SpliceRouter;
+    void setSpliceRouter(SpliceRouter router) { spliceRouter = std::move(router); }
+    // 可以作为 splice 目标：发送队列为空且没有其他进行中的转发。协商了分片的连接不作为目标：
+    // splice 的整帧不经过车道，转发期间控制和响应车道的数据只能排在它之后
+    bool canAcceptRelay() const {
+        return !closed && !closing && !relayIn && !fragmentsEnabled && outboundBytes() == 0;
+    }
+
+    int getFd() const { return fd; }
+    const std::string& peerName() const { return peer; }
+    bool isClosed() const { return closed; }
+    size_t outboundBytes() const { return outBuffer.size() - outPos + queuedBytes; }
+
+    // co_await conn.readPacket()：取出下一个完整数据包，连接关闭时抛出异常
+    struct ReadAwaiter {
+        Connection& conn;
+        bool await_ready();
+        void await_suspend(std::coroutine_handle<> h);
+        Packet await_resume();
+    };
+    ReadAwaiter readPacket() { return ReadAwaiter{*this}; }
+
+    // co_await conn.writable()：等待发送队列低于高水位，返回连接是否仍然可用
+    struct WritableAwaiter {
+        Connection& conn;
+        bool await_ready() const { return conn.closed || conn.outboundBytes() < OUTBOUND_HIGH_WATERMARK; }
+        void await_suspend(std::coroutine_handle<> h) { conn.writeWaiters.push_back(h); }
+        bool await_resume() const { return !conn.closed; }
+    };
+    WritableAwaiter writable() { return WritableAwaiter{*this}; }
+
+    // 将数据包放入其类型对应的车道并尽量立即发送；连接已关闭时返回 false
+    bool send(const Packet& pkt);
+    static OutboundLane laneFor(MessageType type);
+
+    // 立即关闭连接
+    void close(const std::string& reason);
+    // 发送队列清空后关闭连接
+    void closeAfterFlush();
+    // 退出时使用：阻塞地发送剩余数据（最多等待 timeoutMs）
+    void flushBlocking(int timeoutMs);
+
+    void onEvents(uint32_t events) override;
+
+private:
+    EventLoop& loop;
+    int fd;
+    std::string peer;
+    FrameDecoder decoder;
+    size_t maxFrameSize;
+    PacketCodec codec;
+    struct Lane {
+        std::deque<Packet> packets;
+        size_t offset = 0;   // 队首数据包已作为分片发出的字节数
+        int64_t deficit = 0; // 本轮剩余额度（可为负，下一轮补足）
+    };
+    Lane lanes[LANE_COUNT];
+    std::array<uint32_t, LANE_COUNT> laneWeights;
+    bool fragmentsEnabled;
+    size_t queuedBytes;     // 各车道中尚未取出的字节数（含帧头）
+    std::string outBuffer;  // 已从车道取出、正在写入 socket 的帧
+    size_t outPos;
+    bool readPaused;
+    bool wantWrite;
+    bool peerEof;
+    bool closed;
+    bool closing;
+    std::string closeReason;
+    Packet pending;  // 已解出、尚未交给读协程的数据包
+    bool hasPending;
+    // 追踪用：每次 recv 后累计读入解码器的字节数与时间，解出数据包时据此找到读到其最后一个字节的时间
+    uint64_t bytesDecoded;
+    std::deque<std::pair<uint64_t, uint64_t>> readTimes; // (累计字节数, 纳秒)
+    std::coroutine_handle<> readWaiter;
+    std::vector<std::coroutine_handle<>> writeWaiters;
+    std::shared_ptr<Connection> selfRef; // 注册在事件循环期间保持存活
+    SpliceRouter spliceRouter;
+    std::shared_ptr<SpliceRelay> relayOut; // 本连接作为源的转发
+    std::shared_ptr<SpliceRelay> relayIn;  // 本连接作为目标的转发（期间 send() 的数据排在其后）
+    size_t skipBytes;                      // 目标中途断开后需丢弃的帧剩余字节
+
+    enum RelayEnd { RELAY_DONE, RELAY_SOURCE_FAILED, RELAY_TARGET_FAILED };
+    bool trySplice();
+    static void pumpRelay(std::shared_ptr<SpliceRelay> relay);
+    static void finishRelay(const std::shared_ptr<SpliceRelay>& relay, RelayEnd end);
+
+    bool tryDecode();
+    void handleReadable();
+    void schedule();
+    size_t takeFrame(Lane& lane, bool split);
+    bool encodePacket(const Packet& pkt, Packet& out);
+    void flush();
+    void updateInterest();
+    void wakeReader();
+    void wakeWriters();
+};
+
+#endif // CONNECTION_H
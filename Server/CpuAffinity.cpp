@@ -0,0 +1,120 @@
+// CpuAffinity.cpp
+
+#include "CpuAffinity.h"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <set>
+#include <sstream>
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <linux/mempolicy.h>
+#include <glog/logging.h>
+
+namespace {
+
+// 只设置调用线程的策略（不需要 libnuma）。内核把 maxnode 减一后才使用，因此要多传一位
+bool preferNumaNode(int node) {
+    unsigned long mask = 1ul << node;
+    return syscall(SYS_set_mempolicy, MPOL_PREFERRED, &mask, sizeof(mask) * 8 + 1) == 0;
+}
+
+bool resetMemoryPolicy() {
+    return syscall(SYS_set_mempolicy, MPOL_DEFAULT, nullptr, 0) == 0;
+}
+
+// 进程启动时的 CPU 集合（例如 taskset 指定的）。第一次调用发生在主线程绑核之前
+const cpu_set_t& startupAffinity() {
+    static const cpu_set_t mask = [] {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof(set), &set) != 0) {
+            for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+                CPU_SET(cpu, &set);
+            }
+        }
+        return set;
+    }();
+    return mask;
+}
+
+} // namespace
+
+int cpuNumaNode(int cpu) {
+    // /sys/devices/system/cpu/cpuN/ 下有一个指向所属节点的 nodeM 链接
+    std::string path = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+    DIR* dir = opendir(path.c_str());
+    if (dir == nullptr) {
+        return -1;
+    }
+    int node = -1;
+    while (struct dirent* entry = readdir(dir)) {
+        if (strncmp(entry->d_name, "node", 4) == 0 && entry->d_name[4] >= '0' && entry->d_name[4] <= '9') {
+            node = atoi(entry->d_name + 4);
+            break;
+        }
+    }
+    closedir(dir);
+    return node;
+}
+
+std::string describeCpuList(const std::vector<int>& cpus) {
+    std::set<int> sorted(cpus.begin(), cpus.end());
+    std::ostringstream out;
+    auto it = sorted.begin();
+    while (it != sorted.end()) {
+        int first = *it;
+        int last = first;
+        while (++it != sorted.end() && *it == last + 1) {
+            last = *it;
+        }
+        out << (out.tellp() > 0 ? "," : "") << first;
+        if (last != first) {
+            out << "-" << last;
+        }
+    }
+    return out.str();
+}
+
+bool pinCurrentThread(const std::vector<int>& cpus, const char* role) {
+    const cpu_set_t& unpinned = startupAffinity();
+    if (cpus.empty()) {
+        // 新线程继承创建者（可能已绑核的事件循环线程）的 CPU 集合和内存策略，不绑定就要恢复原状
+        int ret = pthread_setaffinity_np(pthread_self(), sizeof(unpinned), &unpinned);
+        if (ret != 0 || !resetMemoryPolicy()) {
+            LOG(ERROR) << "Failed to reset the CPU affinity of the " << role << " thread: "
+                       << strerror(ret != 0 ? ret : errno);
+            return false;
+        }
+        return true;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    std::set<int> nodes;
+    for (int cpu : cpus) {
+        CPU_SET(cpu, &set);
+        nodes.insert(cpuNumaNode(cpu));
+    }
+    int ret = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (ret != 0) {
+        LOG(ERROR) << "Failed to pin " << role << " thread to CPUs " << describeCpuList(cpus) << ": " << strerror(ret);
+        return false;
+    }
+    std::ostringstream placement;
+    placement << "Pinned " << role << " thread to CPUs " << describeCpuList(cpus);
+    int node = *nodes.begin();
+    if (nodes.size() == 1 && node >= 0 && node < static_cast<int>(sizeof(unsigned long) * 8)) {
+        if (preferNumaNode(node)) {
+            placement << ", allocating from NUMA node " << node;
+        } else {
+            placement << " (set_mempolicy failed: " << strerror(errno) << ")";
+        }
+    } else {
+        placement << " spanning " << nodes.size() << " NUMA nodes (first-touch allocation)";
+    }
+    LOG(INFO) << placement.str() << ".";
+    return true;
+}
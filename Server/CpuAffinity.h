@@ -0,0 +1,25 @@
+// CpuAffinity.h
+// 线程绑核与 NUMA 本地内存分配
+//
+// - 事件循环（I/O）、接受线程和后台工作线程（抓包写线程）可以分别绑定到一组 CPU（--io-cpus 等）
+// - 绑核后，如果这组 CPU 都在同一个 NUMA 节点上，就把该线程的内存策略设为优先从这个节点分配；
+//   跨节点时保持内核默认的 first-touch。连接的解码缓冲区、发送队列等都由事件循环线程分配并首次写入，
+//   因此只要在创建它们之前绑核，就会落在本地节点上
+#ifndef CPUAFFINITY_H
+#define CPUAFFINITY_H
+
+#include <string>
+#include <vector>
+
+// 把调用线程绑定到 cpus，role 只用于日志。失败时记录日志并返回 false。
+// cpus 为空时恢复进程启动时的 CPU 集合和默认内存策略，不受创建该线程的线程是否绑核的影响；
+// 主线程应最先调用（在创建其他线程之前），以便记下启动时的 CPU 集合
+bool pinCurrentThread(const std::vector<int>& cpus, const char* role);
+
+// CPU 所在的 NUMA 节点，无法确定时返回 -1
+int cpuNumaNode(int cpu);
+
+// 以 "0-3,8" 的形式描述 CPU 列表
+std::string describeCpuList(const std::vector<int>& cpus);
+
+#endif // CPUAFFINITY_H
@@ -0,0 +1,222 @@
+// EventLoop.cpp
+
+#include "EventLoop.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <glog/logging.h>
+
+#define LOOP_MAX_EVENTS 256
+#define LOOP_MAX_WAIT_MS 1000 // 无定时器时 epoll_wait 的最长等待
+#define LOOP_BUSY_POLL_BUDGET 8 // 每次忙轮询最多处理的数据包数（内核默认值）
+
+#ifndef EPIOCSPARAMS
+// Linux 6.9 引入的 epoll 忙轮询参数，较旧的系统头文件中没有
+struct epoll_params {
+    uint32_t busy_poll_usecs;
+    uint16_t busy_poll_budget;
+    uint8_t prefer_busy_poll;
+    uint8_t __pad;
+};
+#define EPIOCSPARAMS _IOW(0x8A, 0x01, struct epoll_params)
+#endif
+
+EventLoop::EventLoop() : running(true), spinMicros(0), spinWakeups(0), parkedWaits(0), nextTimerId(1) {
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd < 0) {
+        throw std::runtime_error("Failed to create epoll instance.");
+    }
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeFd < 0) {
+        close(epollFd);
+        throw std::runtime_error("Failed to create eventfd.");
+    }
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = nullptr; // nullptr 表示唤醒事件
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &ev);
+}
+
+EventLoop::~EventLoop() {
+    close(wakeFd);
+    close(epollFd);
+}
+
+void EventLoop::run() {
+    // running 在构造时即为 true：run() 之前调用的 stop() 不会丢失
+    struct epoll_event events[LOOP_MAX_EVENTS];
+    while (running) {
+        int n = waitEvents(events);
+        if (n < 0 && errno != EINTR) {
+            LOG(ERROR) << "epoll_wait failed: " << strerror(errno);
+            break;
+        }
+        for (int i = 0; i < n; i++) {
+            EventHandler* handler = static_cast<EventHandler*>(events[i].data.ptr);
+            if (handler == nullptr) {
+                uint64_t value;
+                ssize_t ret = read(wakeFd, &value, sizeof(value));
+                (void)ret;
+                continue;
+            }
+            handler->onEvents(events[i].events);
+            runReady();
+        }
+        runTimers();
+        runPosted();
+        runReady();
+    }
+}
+
+int EventLoop::waitEvents(struct epoll_event* events) {
+    int timeout = computeTimeout();
+    if (spinMicros > 0 && timeout != 0) {
+        // 轮询期间到来的事件省掉一次睡眠和唤醒（微秒级），代价是空闲时也占满 CPU；不越过最近的定时器
+        Clock::time_point deadline = Clock::now() + std::chrono::microseconds(spinMicros);
+        if (!timers.empty()) {
+            deadline = std::min(deadline, timers.begin()->first);
+        }
+        do {
+            int n = epoll_wait(epollFd, events, LOOP_MAX_EVENTS, 0);
+            if (n != 0) {
+                spinWakeups += n > 0;
+                return n;
+            }
+        } while (running && Clock::now() < deadline);
+        timeout = computeTimeout();
+    }
+    parkedWaits++;
+    return epoll_wait(epollFd, events, LOOP_MAX_EVENTS, timeout);
+}
+
+bool EventLoop::setBusyPoll(uint32_t busyPollUs) {
+    struct epoll_params params;
+    memset(&params, 0, sizeof(params));
+    params.busy_poll_usecs = busyPollUs;
+    params.busy_poll_budget = LOOP_BUSY_POLL_BUDGET;
+    params.prefer_busy_poll = busyPollUs > 0;
+    if (ioctl(epollFd, EPIOCSPARAMS, &params) < 0) {
+        LOG(ERROR) << "Failed to enable epoll busy polling: " << strerror(errno)
+                   << " (falling back to net.core.busy_poll and per-socket SO_BUSY_POLL).";
+        return false;
+    }
+    return true;
+}
+
+std::string EventLoop::describeWaitStats() const {
+    std::ostringstream out;
+    out << "spin_us=" << spinMicros << " spin_wakeups=" << spinWakeups << " parked=" << parkedWaits;
+    return out.str();
+}
+
+void EventLoop::stop() {
+    // 只做原子写和 write(2)，可在信号处理函数中调用
+    running = false;
+    uint64_t one = 1;
+    ssize_t ret = write(wakeFd, &one, sizeof(one));
+    (void)ret;
+}
+
+void EventLoop::addFd(int fd, uint32_t events, EventHandler* handler) {
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events;
+    ev.data.ptr = handler;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        throw std::runtime_error("epoll_ctl ADD failed.");
+    }
+}
+
+void EventLoop::modifyFd(int fd, uint32_t events, EventHandler* handler) {
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events;
+    ev.data.ptr = handler;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &ev);
+}
+
+void EventLoop::removeFd(int fd) {
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+}
+
+EventLoop::TimerId EventLoop::runAfter(int delayMs, Callback cb) {
+    TimerId id = nextTimerId++;
+    auto it = timers.emplace(Clock::now() + std::chrono::milliseconds(delayMs), Timer{id, std::move(cb)});
+    timerIndex[id] = it;
+    return id;
+}
+
+void EventLoop::cancelTimer(TimerId id) {
+    auto it = timerIndex.find(id);
+    if (it != timerIndex.end()) {
+        timers.erase(it->second);
+        timerIndex.erase(it);
+    }
+}
+
+void EventLoop::schedule(std::coroutine_handle<> handle) {
+    ready.push_back(handle);
+}
+
+void EventLoop::post(Callback cb) {
+    {
+        std::lock_guard<std::mutex> lock(postMutex);
+        posted.push_back(std::move(cb));
+    }
+    uint64_t one = 1;
+    ssize_t ret = write(wakeFd, &one, sizeof(one));
+    (void)ret;
+}
+
+int EventLoop::computeTimeout() const {
+    if (!ready.empty()) {
+        return 0;
+    }
+    if (timers.empty()) {
+        return LOOP_MAX_WAIT_MS;
+    }
+    auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(timers.begin()->first - Clock::now()).count();
+    if (wait < 0) {
+        return 0;
+    }
+    // 向上取整，避免定时器提前 1ms 醒来后空转
+    return static_cast<int>(std::min<long long>(wait + 1, LOOP_MAX_WAIT_MS));
+}
+
+void EventLoop::runTimers() {
+    auto now = Clock::now();
+    while (!timers.empty() && timers.begin()->first <= now) {
+        Timer timer = std::move(timers.begin()->second);
+        timers.erase(timers.begin());
+        timerIndex.erase(timer.id);
+        timer.cb();
+        runReady();
+    }
+}
+
+void EventLoop::runPosted() {
+    std::vector<Callback> tasks;
+    {
+        std::lock_guard<std::mutex> lock(postMutex);
+        tasks.swap(posted);
+    }
+    for (auto& task : tasks) {
+        task();
+        runReady();
+    }
+}
+
+void EventLoop::runReady() {
+    while (!ready.empty()) {
+        std::coroutine_handle<> h = ready.front();
+        ready.pop_front();
+        h.resume();
+    }
+}
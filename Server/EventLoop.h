@@ -0,0 +1,109 @@
+// EventLoop.h
+// 服务器事件循环：epoll + 定时器 + 跨线程投递 + 协程就绪队列
+#ifndef EVENTLOOP_H
+#define EVENTLOOP_H
+
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct epoll_event;
+
+// epoll 事件处理接口
+class EventHandler {
+public:
+    virtual ~EventHandler() {}
+    virtual void onEvents(uint32_t events) = 0;
+};
+
+class EventLoop {
+public:
+    typedef std::function<void()> Callback;
+    typedef uint64_t TimerId;
+    typedef std::chrono::steady_clock Clock;
+
+    EventLoop();
+    ~EventLoop();
+
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    // 在调用线程中运行，直到 stop()
+    void run();
+    // 可在任意线程或信号处理函数中调用
+    void stop();
+    bool isRunning() const { return running; }
+
+    // 低延迟模式（run() 之前调用）：
+    // spinUs > 0 时每次等待先以 0 超时轮询 spinUs 微秒，仍无事件才阻塞（spin-then-park）；
+    // busyPollUs > 0 时让内核在 epoll_wait 中忙轮询网卡队列（需要 Linux 6.9+，不支持时记录日志并返回 false）
+    void setSpin(uint32_t spinUs) { spinMicros = spinUs; }
+    bool setBusyPoll(uint32_t busyPollUs);
+
+    // 以下仅可在事件循环线程中调用
+    std::string describeWaitStats() const;
+    void addFd(int fd, uint32_t events, EventHandler* handler);
+    void modifyFd(int fd, uint32_t events, EventHandler* handler);
+    void removeFd(int fd);
+
+    TimerId runAfter(int delayMs, Callback cb);
+    void cancelTimer(TimerId id);
+
+    // 在当前事件处理完成后恢复协程（避免在回调内部嵌套恢复）
+    void schedule(std::coroutine_handle<> handle);
+
+    // 线程安全：将任务投递到事件循环线程
+    void post(Callback cb);
+
+    // co_await loop.sleepFor(ms)
+    struct SleepAwaiter {
+        EventLoop& loop;
+        int delayMs;
+        bool await_ready() const noexcept { return delayMs <= 0; }
+        void await_suspend(std::coroutine_handle<> h) {
+            EventLoop* l = &loop;
+            loop.runAfter(delayMs, [l, h] { l->schedule(h); });
+        }
+        void await_resume() const noexcept {}
+    };
+    SleepAwaiter sleepFor(int delayMs) { return SleepAwaiter{*this, delayMs}; }
+
+private:
+    struct Timer {
+        TimerId id;
+        Callback cb;
+    };
+    typedef std::multimap<Clock::time_point, Timer> TimerQueue;
+
+    int epollFd;
+    int wakeFd;
+    std::atomic<bool> running;
+    uint32_t spinMicros;
+    uint64_t spinWakeups; // 轮询期间等到的事件（省掉的睡眠/唤醒）
+    uint64_t parkedWaits; // 阻塞等待次数
+
+    TimerQueue timers;
+    std::unordered_map<TimerId, TimerQueue::iterator> timerIndex;
+    TimerId nextTimerId;
+
+    std::deque<std::coroutine_handle<>> ready;
+
+    std::mutex postMutex;
+    std::vector<Callback> posted;
+
+    int computeTimeout() const;
+    int waitEvents(struct epoll_event* events);
+    void runTimers();
+    void runPosted();
+    void runReady();
+};
+
+#endif // EVENTLOOP_H
@@ -0,0 +1,185 @@
+// FlowControl.cpp
+
+#include "FlowControl.h"
+#include <algorithm>
+#include <vector>
+
+FlowControl::FlowControl(const ServerConfig& cfg, DeliverFn fn, ReadyFn readyFn)
+    : config(cfg), deliver(std::move(fn)), ready(std::move(readyFn)) {}
+
+FlowControl::PairState& FlowControl::pairFor(int sender, int receiver) {
+    auto it = pairs.find(std::make_pair(sender, receiver));
+    if (it == pairs.end()) {
+        PairState state;
+        state.messageCredit = config.creditMessages;
+        state.byteCredit = config.creditBytes;
+        it = pairs.emplace(std::make_pair(sender, receiver), std::move(state)).first;
+        clientPairs[sender].insert(it->first);
+        clientPairs[receiver].insert(it->first);
+    }
+    return it->second;
+}
+
+void FlowControl::erasePair(PairMap::iterator it) {
+    for (int clientId : {it->first.first, it->first.second}) {
+        auto indexIt = clientPairs.find(clientId);
+        if (indexIt != clientPairs.end()) {
+            indexIt->second.erase(it->first);
+            if (indexIt->second.empty()) {
+                clientPairs.erase(indexIt);
+            }
+        }
+    }
+    pairs.erase(it);
+}
+
+bool FlowControl::hasCredit(int receiver, const PairState& pair, const ReceiverState& recv, size_t bytes) const {
+    if (pair.messageCredit == 0) {
+        return false;
+    }
+    // 超过整个窗口的大消息：窗口完全空闲时放行，否则永远无法发送
+    if (pair.byteCredit < bytes && pair.byteCredit < config.creditBytes) {
+        return false;
+    }
+    if (recv.inFlightBytes > 0 && recv.inFlightBytes + bytes > config.receiverMaxInFlightBytes) {
+        return false;
+    }
+    // 信用只说明接收方声称处理完了，发送队列积压时同样要停下
+    return ready(receiver);
+}
+
+bool FlowControl::deliverNow(int sender, int receiver, PairState& pair, Packet&& message) {
+    uint64_t bytes = message.data.size();
+    ReceiverState& recv = receivers[receiver];
+    pair.messageCredit--;
+    pair.byteCredit -= std::min<uint64_t>(bytes, pair.byteCredit);
+    recv.unacked.push_back(Delivery{sender, bytes});
+    recv.inFlightBytes += bytes;
+    return deliver(sender, receiver, std::move(message));
+}
+
+FlowControl::Result FlowControl::submit(int sender, int receiver, Packet&& message) {
+    PairState& pair = pairFor(sender, receiver);
+    ReceiverState& recv = receivers[receiver];
+
+    // 已有排队消息时必须排在其后，保证同一发送方的消息顺序
+    if (pair.queued.empty() && hasCredit(receiver, pair, recv, message.data.size())) {
+        deliverNow(sender, receiver, pair, std::move(message));
+        return SENT;
+    }
+
+    uint64_t& queuedBytes = senderQueuedBytes[sender];
+    if (pair.queued.size() >= config.pairMaxQueuedMessages ||
+        queuedBytes + message.data.size() > config.senderMaxQueuedBytes) {
+        return REJECTED;
+    }
+    queuedBytes += message.data.size();
+    pair.queued.push_back(std::move(message));
+    recv.waitingSenders.insert(sender);
+    return QUEUED;
+}
+
+void FlowControl::grant(int receiver, uint32_t count) {
+    auto recvIt = receivers.find(receiver);
+    if (recvIt == receivers.end()) {
+        return;
+    }
+    ReceiverState& recv = recvIt->second;
+    while (count > 0 && !recv.unacked.empty()) {
+        Delivery delivery = recv.unacked.front();
+        recv.unacked.pop_front();
+        recv.inFlightBytes -= delivery.bytes;
+        count--;
+
+        auto pairIt = pairs.find(std::make_pair(delivery.sender, receiver));
+        if (pairIt == pairs.end()) {
+            continue; // 发送方已断开
+        }
+        PairState& pair = pairIt->second;
+        pair.messageCredit = std::min(pair.messageCredit + 1, config.creditMessages);
+        pair.byteCredit = std::min(pair.byteCredit + delivery.bytes, config.creditBytes);
+        // 信用完全恢复且无排队的对不再保留状态
+        if (pair.queued.empty() && pair.messageCredit == config.creditMessages &&
+            pair.byteCredit == config.creditBytes) {
+            erasePair(pairIt);
+        }
+    }
+
+    // 接收方的在途字节减少后，所有在等它的发送方都可能可以继续
+    receiverReady(receiver);
+}
+
+void FlowControl::receiverReady(int receiver) {
+    auto recvIt = receivers.find(receiver);
+    if (recvIt == receivers.end()) {
+        return;
+    }
+    std::vector<int> waiting(recvIt->second.waitingSenders.begin(), recvIt->second.waitingSenders.end());
+    for (int sender : waiting) {
+        drain(sender, receiver);
+    }
+}
+
+void FlowControl::drain(int sender, int receiver) {
+    ReceiverState& recv = receivers[receiver];
+    auto pairIt = pairs.find(std::make_pair(sender, receiver));
+    if (pairIt == pairs.end()) {
+        recv.waitingSenders.erase(sender);
+        return;
+    }
+    PairState& pair = pairIt->second;
+    while (!pair.queued.empty() && hasCredit(receiver, pair, recv, pair.queued.front().data.size())) {
+        Packet message = std::move(pair.queued.front());
+        pair.queued.pop_front();
+        senderQueuedBytes[sender] -= message.data.size();
+        if (!deliverNow(sender, receiver, pair, std::move(message))) {
+            break;
+        }
+    }
+    if (pair.queued.empty()) {
+        recv.waitingSenders.erase(sender);
+    }
+}
+
+void FlowControl::removeClient(int clientId) {
+    receivers.erase(clientId);
+    senderQueuedBytes.erase(clientId);
+    // 只访问该客户端参与的对，断开连接的开销与服务器上的总对数无关
+    auto indexIt = clientPairs.find(clientId);
+    if (indexIt == clientPairs.end()) {
+        return;
+    }
+    std::set<std::pair<int, int>> involved;
+    involved.swap(indexIt->second);
+    clientPairs.erase(indexIt);
+    for (const std::pair<int, int>& key : involved) {
+        auto it = pairs.find(key);
+        if (it == pairs.end()) {
+            continue;
+        }
+        int sender = key.first;
+        int receiver = key.second;
+        if (sender == clientId) {
+            auto recvIt = receivers.find(receiver);
+            if (recvIt != receivers.end()) {
+                recvIt->second.waitingSenders.erase(sender);
+            }
+        } else {
+            // 发给已断开接收方的排队消息一并丢弃
+            for (const Packet& message : it->second.queued) {
+                senderQueuedBytes[sender] -= message.data.size();
+            }
+        }
+        erasePair(it);
+    }
+}
+
+uint64_t FlowControl::queuedBytes(int sender) const {
+    auto it = senderQueuedBytes.find(sender);
+    return it == senderQueuedBytes.end() ? 0 : it->second;
+}
+
+uint64_t FlowControl::inFlightBytes(int receiver) const {
+    auto it = receivers.find(receiver);
+    return it == receivers.end() ? 0 : it->second.inFlightBytes;
+}
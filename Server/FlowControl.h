@@ -0,0 +1,83 @@
+// FlowControl.h
+// 转发消息（SEND_MESSAGE）的端到端信用流控
+//
+// - 每个 (发送方, 接收方) 对有一个消息数/字节数信用窗口，每转发一条消息消耗一份信用
+// - 接收方处理完消息后发送 GRANT_CREDIT "N"，表示已消费最早的 N 条转发消息，
+//   服务器按投递顺序把对应的信用还给各自的发送方，并继续投递排队的消息
+// - 信用耗尽时消息在服务器排队；排队超出上限时拒绝，发送方收到 BACKPRESSURE
+// - 每个接收方的在途字节数、每个发送方的排队字节数都有上限；接收方的发送队列超过高水位时也不再投递
+//   （接收方可以只发 GRANT_CREDIT 而不读 socket），因此单个连接占用的服务器内存有硬上限
+#ifndef FLOWCONTROL_H
+#define FLOWCONTROL_H
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include "Message/MySocket.h"
+#include "ServerConfig.h"
+
+class FlowControl {
+public:
+    enum Result {
+        SENT,     // 已投递给接收方
+        QUEUED,   // 信用不足，已在服务器排队
+        REJECTED  // 排队已满，拒绝（背压）
+    };
+
+    // 投递回调：把消息发给接收方，接收方已断开时返回 false。
+    // message 是要发给接收方的 SEND_MESSAGE 数据包（数据可能是共享字典压缩的，按压缩后的字节计算信用）
+    typedef std::function<bool(int sender, int receiver, Packet&& message)> DeliverFn;
+    // 接收方的发送队列现在能否继续接收。返回 false 时调用方负责在队列回落后调用 receiverReady()
+    typedef std::function<bool(int receiver)> ReadyFn;
+
+    FlowControl(const ServerConfig& config, DeliverFn deliver, ReadyFn ready);
+
+    Result submit(int sender, int receiver, Packet&& message);
+    // 接收方已消费 count 条消息
+    void grant(int receiver, uint32_t count);
+    // 接收方的发送队列已回落：继续投递排队的消息
+    void receiverReady(int receiver);
+    // 客户端断开：丢弃与其相关的所有状态
+    void removeClient(int clientId);
+
+    uint64_t queuedBytes(int sender) const;
+    uint64_t inFlightBytes(int receiver) const;
+
+private:
+    struct PairState {
+        uint32_t messageCredit;
+        uint64_t byteCredit;
+        std::deque<Packet> queued;
+    };
+    struct Delivery {
+        int sender;
+        uint64_t bytes;
+    };
+    struct ReceiverState {
+        std::deque<Delivery> unacked; // 已投递、未被 GRANT_CREDIT 确认的消息
+        uint64_t inFlightBytes = 0;
+        std::set<int> waitingSenders; // 有消息在排队等待该接收方信用的发送方
+    };
+
+    const ServerConfig& config;
+    DeliverFn deliver;
+    ReadyFn ready;
+    typedef std::map<std::pair<int, int>, PairState> PairMap;
+    PairMap pairs; // (sender, receiver)
+    std::unordered_map<int, std::set<std::pair<int, int>>> clientPairs; // 客户端 -> 它作为发送方或接收方的对
+    std::unordered_map<int, ReceiverState> receivers;
+    std::unordered_map<int, uint64_t> senderQueuedBytes;
+
+    PairState& pairFor(int sender, int receiver);
+    void erasePair(PairMap::iterator it);
+    bool hasCredit(int receiver, const PairState& pair, const ReceiverState& recv, size_t bytes) const;
+    bool deliverNow(int sender, int receiver, PairState& pair, Packet&& message);
+    void drain(int sender, int receiver);
+};
+
+#endif // FLOWCONTROL_H
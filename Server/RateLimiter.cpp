@@ -0,0 +1,80 @@
+// RateLimiter.cpp
+
+#include "RateLimiter.h"
+#include <sstream>
+
+RateLimiter::RateLimiter(const ServerConfig& cfg)
+    : config(cfg), forwardBytes(cfg.forwardBytesRate.rate, cfg.forwardBytesRate.burst) {}
+
+std::shared_ptr<ConnectionRateState> RateLimiter::newConnectionState() const {
+    std::shared_ptr<ConnectionRateState> state = std::make_shared<ConnectionRateState>(config.connectionRate);
+    for (const auto& [type, spec] : config.typeRates) {
+        state->byType.emplace(type, std::unique_ptr<TokenBucket>(new TokenBucket(spec.rate, spec.burst)));
+    }
+    return state;
+}
+
+bool RateLimiter::admit(ConnectionRateState& state, MessageType type, std::string& reason) {
+    if (type == DISCONNECT || type == GRANT_CREDIT || type == STREAM_CHUNK) {
+        // 断开请求和信用确认从不限流（信用确认没有响应，不能回复限流提示）；
+        // 流分块丢弃会破坏整个流，改由 admitStream 延后转发
+        return true;
+    }
+    uint32_t now = coarseNowMs();
+    if (!state.messages.tryAcquire(1, now)) {
+        state.throttled++;
+        stats.throttledConnection.fetch_add(1, std::memory_order_relaxed);
+        reason = "Rate limit exceeded. Request dropped.";
+        return false;
+    }
+    auto it = state.byType.find(type);
+    if (it != state.byType.end() && !it->second->tryAcquire(1, now)) {
+        state.throttled++;
+        stats.throttledByType.fetch_add(1, std::memory_order_relaxed);
+        reason = "Rate limit exceeded for this command. Request dropped.";
+        return false;
+    }
+    return true;
+}
+
+bool RateLimiter::admitForward(size_t bytes) {
+    uint32_t cost = bytes > UINT32_MAX ? UINT32_MAX : static_cast<uint32_t>(bytes);
+    if (forwardBytes.tryAcquire(cost, coarseNowMs())) {
+        return true;
+    }
+    stats.throttledForwards.fetch_add(1, std::memory_order_relaxed);
+    stats.throttledForwardBytes.fetch_add(bytes, std::memory_order_relaxed);
+    return false;
+}
+
+bool RateLimiter::admitStream(ConnectionRateState& state, size_t bytes) {
+    uint32_t now = coarseNowMs();
+    auto typeBucket = state.byType.find(STREAM_CHUNK);
+    uint32_t cost = bytes > UINT32_MAX ? UINT32_MAX : static_cast<uint32_t>(bytes);
+    if (state.streamStage == 0 && state.messages.tryAcquire(1, now)) {
+        state.streamStage = 1;
+    }
+    if (state.streamStage == 1 && (typeBucket == state.byType.end() || typeBucket->second->tryAcquire(1, now))) {
+        state.streamStage = 2;
+    }
+    if (state.streamStage != 2 || !forwardBytes.tryAcquire(cost, now)) {
+        if (!state.streamDelayed) {
+            state.streamDelayed = true;
+            stats.delayedStreamChunks.fetch_add(1, std::memory_order_relaxed);
+        }
+        return false;
+    }
+    state.streamStage = 0;
+    state.streamDelayed = false;
+    return true;
+}
+
+std::string RateLimiter::describeStats() const {
+    std::ostringstream out;
+    out << "throttled per-connection=" << stats.throttledConnection.load()
+        << " per-type=" << stats.throttledByType.load()
+        << " forwards=" << stats.throttledForwards.load()
+        << " (" << stats.throttledForwardBytes.load() << " bytes)"
+        << " delayed-stream-chunks=" << stats.delayedStreamChunks.load();
+    return out.str();
+}
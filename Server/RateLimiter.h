@@ -0,0 +1,127 @@
+// RateLimiter.h
+// 令牌桶限流：每连接、每连接每消息类型、以及全局转发字节数
+#ifndef RATELIMITER_H
+#define RATELIMITER_H
+
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include "ServerConfig.h"
+
+#define STREAM_THROTTLE_MS 10 // 流分块令牌不足时的重试间隔
+
+// 粗粒度单调时钟（毫秒）：CLOCK_MONOTONIC_COARSE 走 vDSO，只读一个缓存的时间值
+inline uint32_t coarseNowMs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return static_cast<uint32_t>(ts.tv_sec * 1000ULL + ts.tv_nsec / 1000000);
+}
+
+// 无锁令牌桶：令牌数与上次补充时间打包在一个 64 位原子变量里，用 CAS 更新。
+// 取令牌时才按流逝时间惰性补充；补充时只把时间戳推进到“已折算成令牌”的部分，
+// 低速率下不足一个令牌的时间不会被丢弃。
+class TokenBucket {
+private:
+    std::atomic<uint64_t> state; // 高 32 位：时间戳(ms)，低 32 位：令牌数
+    uint32_t rate;               // 每秒补充的令牌数，0 表示不限流
+    uint32_t burst;              // 桶容量
+
+    static uint64_t pack(uint32_t stampMs, uint32_t tokens) {
+        return (static_cast<uint64_t>(stampMs) << 32) | tokens;
+    }
+
+public:
+    TokenBucket(uint32_t ratePerSec, uint32_t burstSize)
+        : state(pack(coarseNowMs(), burstSize)), rate(ratePerSec), burst(burstSize) {}
+
+    TokenBucket(const TokenBucket&) = delete;
+    TokenBucket& operator=(const TokenBucket&) = delete;
+
+    bool unlimited() const { return rate == 0; }
+
+    // 尝试取出 cost 个令牌，不足时不扣除并返回 false
+    bool tryAcquire(uint32_t cost, uint32_t nowMs) {
+        if (rate == 0) {
+            return true;
+        }
+        uint64_t old = state.load(std::memory_order_relaxed);
+        while (true) {
+            uint32_t stamp = static_cast<uint32_t>(old >> 32);
+            uint32_t tokens = static_cast<uint32_t>(old);
+            uint32_t elapsed = nowMs - stamp; // 无符号差值，时钟回绕也正确
+            uint64_t refill = static_cast<uint64_t>(elapsed) * rate / 1000;
+            uint32_t newStamp = stamp;
+            uint64_t available = tokens;
+            if (refill > 0) {
+                available += refill;
+                if (available >= burst) {
+                    available = burst;
+                    newStamp = nowMs;
+                } else {
+                    newStamp = stamp + static_cast<uint32_t>(refill * 1000 / rate);
+                }
+            }
+            // 单次消耗超过桶容量（例如一条大消息）：桶满时放行，避免永远无法通过
+            uint64_t need = cost > burst ? burst : cost;
+            if (available < need) {
+                return false;
+            }
+            uint64_t desired = pack(newStamp, static_cast<uint32_t>(available - need));
+            if (state.compare_exchange_weak(old, desired, std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+    }
+};
+
+// 限流统计（可在任意线程读取）
+struct RateLimitStats {
+    std::atomic<uint64_t> throttledConnection{0};  // 超出每连接限额而丢弃的消息数
+    std::atomic<uint64_t> throttledByType{0};      // 超出每类型限额而丢弃的消息数
+    std::atomic<uint64_t> throttledForwards{0};    // 超出全局转发字节限额而拒绝的转发数
+    std::atomic<uint64_t> throttledForwardBytes{0};
+    std::atomic<uint64_t> delayedStreamChunks{0};  // 因令牌不足而延后转发的流分块数
+};
+
+// 单个连接的限流状态
+class ConnectionRateState {
+public:
+    TokenBucket messages;
+    std::unordered_map<uint32_t, std::unique_ptr<TokenBucket>> byType;
+    uint64_t throttled = 0; // 本连接被丢弃的消息数
+    int streamStage = 0;         // 当前流分块已扣除到第几个桶（重试时不重复扣除）
+    bool streamDelayed = false;  // 当前流分块是否已计入延后统计
+
+    explicit ConnectionRateState(const RateSpec& spec) : messages(spec.rate, spec.burst) {}
+};
+
+class RateLimiter {
+private:
+    const ServerConfig& config;
+    TokenBucket forwardBytes;
+    RateLimitStats stats;
+
+public:
+    explicit RateLimiter(const ServerConfig& cfg);
+
+    // splice 路由和会话协程共用同一个状态
+    std::shared_ptr<ConnectionRateState> newConnectionState() const;
+
+    // 检查一条入站消息是否放行；返回 false 时 reason 为拒绝原因
+    bool admit(ConnectionRateState& state, MessageType type, std::string& reason);
+
+    // 检查全局转发字节限额
+    bool admitForward(size_t bytes);
+
+    // 流分块不能丢弃：依次扣除每连接、每类型和全局转发字节的令牌，不足时返回 false，
+    // 调用方等待 STREAM_THROTTLE_MS 后重试（期间不读取发送方的数据）
+    bool admitStream(ConnectionRateState& state, size_t bytes);
+
+    const RateLimitStats& getStats() const { return stats; }
+    std::string describeStats() const;
+};
+
+#endif // RATELIMITER_H
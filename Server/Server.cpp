@@ -3,34 +3,58 @@
 #include <string>
 #include <cstring>
 #include <unistd.h>
+#include <fcntl.h>
 #include <sys/socket.h>
+#include <sys/epoll.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
-#include <thread>
-#include <vector>
 #include <unordered_map>
-#include <mutex>
+#include <unordered_set>
 #include <csignal> // exit signal handling
 #include <atomic>
 #include <memory>
+#include <sstream>
 #include <glog/logging.h>
-#include "Message/MySocket.h" // 引入封装的Socket类
+#include "Message/MySocket.h" // Packet 定义
+#include "Message/StreamChunk.h"
+#include "Message/Trace.h"
+#include "Message/Scan.h"
+#include "Server/EventLoop.h"
+#include "Server/Connection.h"
+#include "Server/CommandRegistry.h"
+#include "Server/RateLimiter.h"
+#include "Server/FlowControl.h"
+#include "Server/Cluster.h"
+#include "Server/CaptureWriter.h"
+#include "Server/Acceptor.h"
+#include "Server/CpuAffinity.h"
+#include "Server/ServerConfig.h"
 #include <ctime>
 
-#define SERVER_PORT 5869
-#define MAX_CLIENT_QUEUE 20
+#define SHUTDOWN_FLUSH_TIMEOUT_MS 1000 // 退出时向每个客户端发送 DISCONNECT 的最长等待
 
-// 全局变量
+// 全局变量（除 serverRunning 外只在事件循环线程中访问，无需加锁）
 std::atomic<bool> serverRunning(true); // 全局运行标志
-std::mutex clientsMutex;
-std::unordered_map<int, std::pair<std::shared_ptr<MySocket>, std::string>> connectedClients; // 客户端ID -> (Socket, IP:Port)
-int clientIdCounter = 1; // 客户端ID计数器
+EventLoop* serverLoop = nullptr;
+std::unordered_map<int, std::pair<std::shared_ptr<Connection>, std::string>> connectedClients; // 客户端ID -> (连接, IP:Port)
+int clientIdCounter = 1; // 客户端ID计数器（节点内序号）
+CommandRegistry commands; // 消息类型 -> 协程处理函数
+ServerConfig serverConfig; // 命令行参数
+std::unique_ptr<RateLimiter> rateLimiter;
+std::unique_ptr<FlowControl> flowControl; // 转发消息的信用流控
+std::unordered_set<int> stalledReceivers; // 发送队列超过高水位、正在等待回落的接收方
+std::unique_ptr<Cluster> cluster; // 集群模式下的对端连接与客户端目录
+std::unique_ptr<CaptureWriter> capture; // --capture 时记录收到的数据包
+std::unique_ptr<Acceptor> acceptor; // 接受线程与准入控制
 
 // 退出处理函数
 void exitHandler(int signal) {
     LOG(INFO) << "Received exit signal (" << signal << "). Shutting down server...";
     serverRunning = false;
-    // 关闭服务器socket将在main中处理
+    if (serverLoop != nullptr) {
+        serverLoop->stop(); // 只写 eventfd，可在信号处理函数中调用
+    }
 }
 
 // 封装日志初始化和清理
@@ -49,125 +73,508 @@ public:
     }
 };
 int respnsetime=0;
-// 处理客户端请求的函数
-void handleClient(int clientId, std::shared_ptr<MySocket> clientSocketPtr, std::string clientIp, int clientPort) {
-    LOG(INFO) << "Client thread started for " << clientIp << ":" << clientPort 
-              << " (Client ID: " << clientId << ")";
+
+// 当前请求开启了追踪时，让响应（或转发的消息）带上它的时间戳
+void attachTrace(Session& session, Packet& response) {
+    if (!session.trace.empty()) {
+        response.flags |= PACKET_FLAG_TRACE;
+        response.trace = session.trace;
+    }
+}
+
+// 转发的聊天文本是否合法。共享字典压缩的消息虽然原样转发，也要解开检查：
+// 未协商压缩的接收方收到的是服务器解开后的原文，而且任何客户端都可以设置该标志
+bool isValidMessageText(const Packet& message) {
+    if (!(message.flags & PACKET_FLAG_ZDICT)) {
+        return isValidText(message.data);
+    }
+    std::string plain;
+    try {
+        PacketCodec::decompressRelayable(message, plain, serverConfig.maxFrameBytes);
+    } catch (const std::exception&) {
+        return false; // 数据损坏或解开后超过帧上限
+    }
+    return isValidText(plain);
+}
+
+// 发送 RESPONSE：发送队列满时只挂起当前会话，不阻塞事件循环
+
+Task respond(Session& session, Packet response) {
+    // 注意：GCC 12 在 if 条件中直接 co_await 会生成错误代码，先存入局部变量
+    bool writable = co_await session.conn->writable();
+    if (!writable) {
+        throw std::runtime_error("Connection closed before response was sent.");
+    }
+    respnsetime++;
+    attachTrace(session, response);
+    session.conn->send(response);
+    std::cout<<"respnsetime=="<<respnsetime<<std::endl;
+    LOG(INFO) << "Sent response to " << session.clientIp << ":" << session.clientPort 
+              << " (Client ID: " << session.clientId << ")";
+}
+
+Task handleGetTime(Session& session, Packet& pkt) {
+    // 获取当前服务器时间
+    Packet response;
+    response.type = RESPONSE;
+    std::time_t now = std::time(nullptr);
+    response.data = std::ctime(&now);
+    co_await respond(session, std::move(response));
+}
+
+Task handleGetName(Session& session, Packet& pkt) {
+    // 返回服务器名称
+    Packet response;
+    response.type = RESPONSE;
+    response.data = "Zimo Server";
+    co_await respond(session, std::move(response));
+}
+
+// 等接收方的发送队列降到低水位以下，再让信用流控继续投递排队的消息
+Task resumeReceiver(std::shared_ptr<Connection> conn, int receiver) {
+    bool writable = co_await conn->writable();
+    stalledReceivers.erase(receiver);
+    if (writable) {
+        flowControl->receiverReady(receiver);
+    }
+}
+
+// 信用流控投递前的检查：接收方不读 socket 时发送队列会一直增长，超过高水位就暂停投递
+bool isReceiverReady(int receiver) {
+    auto it = connectedClients.find(receiver);
+    if (it == connectedClients.end()) {
+        return true; // 由投递回调报告接收方已断开
+    }
+    const std::shared_ptr<Connection>& conn = it->second.first;
+    if (conn->outboundBytes() < OUTBOUND_HIGH_WATERMARK) {
+        return true;
+    }
+    if (stalledReceivers.insert(receiver).second) {
+        spawn(resumeReceiver(conn, receiver));
+    }
+    return false;
+}
+
+// 把消息交给本节点客户端（经过信用流控）；也用于处理其他节点转发来的消息
+ForwardResult submitLocal(int sender, int receiver, Packet&& message) {
+    if (connectedClients.find(receiver) == connectedClients.end()) {
+        return FORWARD_NOT_FOUND;
+    }
+    switch (flowControl->submit(sender, receiver, std::move(message))) {
+        case FlowControl::SENT:
+            return FORWARD_SENT;
+        case FlowControl::QUEUED:
+            return FORWARD_QUEUED;
+        default:
+            return FORWARD_REJECTED;
+    }
+}
+
+Task handleSendMessage(Session& session, Packet& pkt) {
+    // 发送消息到指定客户端
+    // 数据格式假设为 "targetId:message"
+    Packet response;
+    response.type = RESPONSE;
+    size_t delimiter = pkt.data.find(':');
+    if (delimiter == std::string::npos) {
+        response.data = "Invalid message format. Use targetId:message.";
+        co_await respond(session, std::move(response));
+        co_return;
+    }
+    std::string targetIdStr = pkt.data.substr(0, delimiter);
+    int targetId = 0;
+    bool validId = true;
+    try {
+        targetId = std::stoi(targetIdStr);
+    } catch (...) {
+        validId = false;
+    }
+    if (!validId) {
+        response.data = "Invalid target client ID.";
+        co_await respond(session, std::move(response));
+        co_return;
+    }
+
+    // 目标可能在本节点，也可能在集群中的其他节点
+    bool local = connectedClients.find(targetId) != connectedClients.end();
+    if (!local && !cluster->isRemoteClient(targetId)) {
+        response.data = "Target client ID not found.";
+        co_await respond(session, std::move(response));
+        co_return;
+    }
+
+    // 发给接收方的只是消息本身；共享字典压缩的消息保持压缩，由接收方的连接决定是否需要解压
+    Packet message;
+    message.type = SEND_MESSAGE;
+    message.flags = pkt.flags & PACKET_FLAG_ZDICT;
+    message.data = pkt.data.substr(delimiter + 1);
+    if (serverConfig.validateText && !isValidMessageText(message)) {
+        response.data = "Message must be UTF-8 text without control characters.";
+        co_await respond(session, std::move(response));
+        co_return;
+    }
+    attachTrace(session, message);
+    if (!rateLimiter->admitForward(message.data.size())) {
+        response.data = "Server busy: forwarding rate limit exceeded. Message dropped.";
+        co_await respond(session, std::move(response));
+        co_return;
+    }
+
+    // 由（目标所在节点的）信用流控决定立即转发、在服务器排队还是拒绝
+    ForwardResult result;
+    if (local) {
+        result = submitLocal(session.clientId, targetId, std::move(message));
+    } else {
+        co_await cluster->forward(session.clientId, targetId, std::move(message), result);
+    }
+    switch (result) {
+        case FORWARD_SENT:
+            response.data = "Message sent to client " + std::to_string(targetId) + ".";
+            LOG(INFO) << "Forwarded message from Client " << session.clientId 
+                      << " to Client " << targetId;
+            break;
+        case FORWARD_QUEUED:
+            response.data = "Message queued for client " + std::to_string(targetId) 
+                          + " (waiting for receiver credit).";
+            break;
+        case FORWARD_REJECTED:
+            response.type = BACKPRESSURE;
+            response.data = std::to_string(targetId) + ":Receiver is not keeping up. Message rejected, retry later.";
+            LOG(WARNING) << "Backpressure: rejected message from Client " << session.clientId 
+                         << " to Client " << targetId;
+            break;
+        case FORWARD_NOT_FOUND:
+            response.data = "Target client ID not found.";
+            break;
+        case FORWARD_UNREACHABLE:
+            response.data = "Node " + std::to_string(cluster->ownerOf(targetId)) 
+                          + " of client " + std::to_string(targetId) + " is unreachable. Message dropped.";
+            LOG(WARNING) << "Failed to route message from Client " << session.clientId 
+                         << " to Client " << targetId;
+            break;
+    }
+    co_await respond(session, std::move(response));
+}
+
+Task handleListClients(Session& session, Packet& pkt) {
+    // 返回在线客户端列表
+    std::string list;
+    for (const auto& [id, clientPair] : connectedClients) {
+        if (id != session.clientId) { // 不包括自己
+            list += "ID " + std::to_string(id) + ": " + clientPair.second + "\n";
+        }
+    }
+    // 集群中其他节点上的客户端（来自同步的客户端目录）
+    for (const Cluster::RemoteClient& client : cluster->remoteClients()) {
+        list += "ID " + std::to_string(client.clientId) + ": " + client.address 
+              + " (node " + std::to_string(client.nodeId) + ")\n";
+    }
+    bool writable = co_await session.conn->writable();
+    if (!writable) {
+        throw std::runtime_error("Connection closed before client list was sent.");
+    }
+    if (list.empty()) {
+        Packet response;
+        response.type = RESPONSE;
+        response.data = "No other clients connected.";
+        attachTrace(session, response);
+        session.conn->send(response);
+    } else {
+        Packet listPkt;
+        listPkt.type = CLIENT_LIST;
+        listPkt.data = list;
+        attachTrace(session, listPkt);
+        session.conn->send(listPkt);
+        LOG(INFO) << "Sent client list to Client " << session.clientId;
+    }
+}
+
+Task handleGrantCredit(Session& session, Packet& pkt) {
+    // 接收方确认已消费 N 条转发消息，不回复
+    uint32_t count = 0;
+    try {
+        count = static_cast<uint32_t>(std::stoul(pkt.data));
+    } catch (...) {
+        LOG(WARNING) << "Invalid GRANT_CREDIT from Client " << session.clientId << ": " << pkt.data;
+        co_return;
+    }
+    flowControl->grant(session.clientId, count);
+}
+
+Task handleStreamChunk(Session& session, Packet& pkt) {
+    // 流分块：边收边转发给目标，不回复；发送方的会话在目标发送队列满或限流令牌不足时挂起，
+    // 不再读取发送方的数据，因此每个流在服务器上最多占用一个分块加目标的发送队列
+    if (pkt.data.size() < STREAM_HEADER_SIZE) {
+        LOG(WARNING) << "Invalid STREAM_CHUNK from Client " << session.clientId;
+        co_return;
+    }
+    // 先扣令牌再查找目标：发往不存在目标的分块（及其中止回复）同样受限
+    while (!rateLimiter->admitStream(*session.rate, pkt.data.size())) {
+        co_await serverLoop->sleepFor(STREAM_THROTTLE_MS);
+    }
+    int targetId = static_cast<int>(StreamChunk::readU32(pkt.data, 0));
+    uint32_t streamId = StreamChunk::readU32(pkt.data, 4);
+    uint32_t flags = StreamChunk::readU32(pkt.data, 8);
+
+    bool delivered = false;
+    auto it = connectedClients.find(targetId);
+    if (it != connectedClients.end()) {
+        std::shared_ptr<Connection> target = it->second.first;
+        bool writable = co_await target->writable();
+        if (writable) {
+            StreamChunk::writeU32(pkt.data, 0, session.clientId); // 接收方看到的是发送方ID
+            delivered = target->send(pkt);
+        }
+    } else if (cluster->isRemoteClient(targetId)) {
+        co_await cluster->forwardStream(session.clientId, targetId, pkt.data, delivered);
+    }
+
+    if (!delivered && !(flags & STREAM_FLAG_ABORT)) {
+        StreamChunk abort;
+        abort.peerId = targetId;
+        abort.streamId = streamId;
+        abort.flags = STREAM_FLAG_ABORT;
+        abort.payload = "Target client " + std::to_string(targetId) + " is not available.";
+        bool writable = co_await session.conn->writable();
+        if (writable) {
+            session.conn->send(abort.toPacket());
+        }
+    }
+}
+
+// 大的流分块：目标在本节点、发送队列为空且未协商分片时，帧的剩余部分由内核直接从发送方 splice 给目标
+// 令牌不足时不 splice，帧照常读入内存，由 handleStreamChunk 等待令牌
+Connection::SpliceRouter makeSpliceRouter(int clientId, std::shared_ptr<ConnectionRateState> rate) {
+    return [clientId, rate](std::string& head, uint32_t frameLength, Packet& abortPacket) -> std::shared_ptr<Connection> {
+        if (head.size() < 8 + STREAM_HEADER_SIZE || StreamChunk::readU32(head, 4) != STREAM_CHUNK) {
+            return nullptr;
+        }
+        int targetId = static_cast<int>(StreamChunk::readU32(head, 8));
+        auto it = connectedClients.find(targetId);
+        if (targetId == clientId || it == connectedClients.end() || !it->second.first->canAcceptRelay()) {
+            return nullptr;
+        }
+        if (!rateLimiter->admitStream(*rate, frameLength - 8)) {
+            return nullptr;
+        }
+        StreamChunk::writeU32(head, 8, clientId);
+        StreamChunk abort;
+        abort.peerId = clientId;
+        abort.streamId = StreamChunk::readU32(head, 12);
+        abort.flags = STREAM_FLAG_ABORT;
+        abort.payload = "Sender disconnected.";
+        abortPacket = abort.toPacket();
+        return it->second.first;
+    };
+}
+
+Task handleHello(Session& session, Packet& pkt) {
+    // 功能协商：数据为客户端支持的编码和功能（逗号分隔），回复接受的部分或 "none"。
+    // 客户端随时都能解开压缩和重组分片，因此发出回复前启用也不会出错
+    bool compression = false;
+    bool fragments = false;
+    std::stringstream offered(pkt.data);
+    std::string feature;
+    while (std::getline(offered, feature, ',')) {
+        if (feature == COMPRESSION_CODEC && serverConfig.compressMinBytes > 0) {
+            compression = true;
+        } else if (feature == PACKET_FEATURE_FRAGMENTS) {
+            fragments = true;
+        }
+    }
+    Packet response;
+    response.type = RESPONSE;
+    if (compression) {
+        response.data = COMPRESSION_CODEC;
+    }
+    if (fragments) {
+        response.data += response.data.empty() ? PACKET_FEATURE_FRAGMENTS : "," PACKET_FEATURE_FRAGMENTS;
+    }
+    if (response.data.empty()) {
+        response.data = "none";
+    }
+    co_await respond(session, std::move(response));
+    if (compression) {
+        session.conn->enableCompression(serverConfig.compressMinBytes);
+        LOG(INFO) << "Client " << session.clientId << " negotiated compression " << COMPRESSION_CODEC;
+    }
+    if (fragments) {
+        session.conn->enableFragments();
+    }
+}
+
+Task handleDisconnect(Session& session, Packet& pkt) {
+    // 断开连接
+    LOG(INFO) << "Client " << session.clientIp << ":" << session.clientPort 
+              << " (ID: " << session.clientId << ") requested disconnection.";
+    Packet response;
+    response.type = RESPONSE;
+    response.data = "Disconnected successfully.";
+    attachTrace(session, response);
+    session.conn->send(response);
+    throw std::runtime_error("Client requested disconnection.");
+    co_return;
+}
+
+Task handleUnknown(Session& session, Packet& pkt) {
+    Packet response;
+    response.type = RESPONSE;
+    response.data = "Unknown command.";
+    co_await respond(session, std::move(response));
+}
+
+// 每个客户端连接一个会话协程：按顺序读取并分发命令
+Task clientSession(Session session) {
+    LOG(INFO) << "Client session started for " << session.clientIp << ":" << session.clientPort 
+              << " (Client ID: " << session.clientId << ")";
     try {
         while (serverRunning) {
-            Packet pkt = clientSocketPtr->recvPacket();
+            Packet pkt = co_await session.conn->readPacket();
             LOG(INFO) << "Received packet of type " << pkt.type 
-                      << " from " << clientIp << ":" << clientPort 
-                      << " (Client ID: " << clientId << ")";
-
-            Packet response;
-            response.type = RESPONSE;
+                      << " from " << session.clientIp << ":" << session.clientPort 
+                      << " (Client ID: " << session.clientId << ")";
+            if (capture) {
+                capture->packetReceived(session.clientId, pkt);
+            }
+            traceStamp(pkt, TRACE_SERVER_DISPATCH);
+            session.trace = (pkt.flags & PACKET_FLAG_TRACE) ? pkt.trace : std::string();
 
-            switch (pkt.type) {
-                case GET_TIME: {
-                    // 获取当前服务器时间
-                    std::time_t now = std::time(nullptr);
-                    response.data = std::ctime(&now);
-                    break;
-                }
-                case GET_NAME: {
-                    // 返回服务器名称
-                    response.data = "Zimo Server";
-                    break;
-                }
-                case SEND_MESSAGE: {
-                    // 发送消息到指定客户端
-                    // 数据格式假设为 "targetId:message"
-                    size_t delimiter = pkt.data.find(':');
-                    if (delimiter == std::string::npos) {
-                        response.data = "Invalid message format. Use targetId:message.";
-                        break;
-                    }
-                    std::string targetIdStr = pkt.data.substr(0, delimiter);
-                    std::string message = pkt.data.substr(delimiter + 1);
-                    int targetId;
-                    try {
-                        targetId = std::stoi(targetIdStr);
-                    } catch (...) {
-                        response.data = "Invalid target client ID.";
-                        break;
-                    }
-
-                    std::lock_guard<std::mutex> lock(clientsMutex);
-                    auto it = connectedClients.find(targetId);
-                    if (it != connectedClients.end()) {
-                        Packet forwardPkt;
-                        forwardPkt.type = SEND_MESSAGE;
-                        forwardPkt.data = message;
-                        it->second.first->sendPacket(forwardPkt);
-                        response.data = "Message sent to client " + std::to_string(targetId) + ".";
-                        LOG(INFO) << "Forwarded message from Client " << clientId 
-                                  << " to Client " << targetId;
-                    } else {
-                        response.data = "Target client ID not found.";
-                    }
+            // 超出限额的消息直接丢弃，只回复一个简短的 RESPONSE（保持请求/响应一一对应）
+            std::string throttleReason;
+            if (!rateLimiter->admit(*session.rate, pkt.type, throttleReason)) {
+                Packet response;
+                response.type = RESPONSE;
+                response.data = throttleReason;
+                attachTrace(session, response);
+                bool writable = co_await session.conn->writable();
+                if (!writable || !session.conn->send(response)) {
                     break;
                 }
-                case LIST_CLIENTS: {
-                    // 返回在线客户端列表
-                    std::lock_guard<std::mutex> lock(clientsMutex);
-                    std::string list;
-                    for (const auto& [id, clientPair] : connectedClients) {
-                        if (id != clientId) { // 不包括自己
-                            list += "ID " + std::to_string(id) + ": " + clientPair.second + "\n";
-                        }
-                    }
-                    if (list.empty()) {
-                        response.data = "No other clients connected.";
-                        clientSocketPtr->sendPacket(response);
-                    } else {
-                        Packet listPkt;
-                        listPkt.type = CLIENT_LIST;
-                        listPkt.data = list;
-                        clientSocketPtr->sendPacket(listPkt);
-                        LOG(INFO) << "Sent client list to Client " << clientId;
-                    }
-                    continue; // 不发送 RESPONSE 类型的包
-                }
-                case DISCONNECT: {
-                    // 断开连接
-                    LOG(INFO) << "Client " << clientIp << ":" << clientPort 
-                              << " (ID: " << clientId << ") requested disconnection.";
-                    response.data = "Disconnected successfully.";
-                    clientSocketPtr->sendPacket(response);
-                    throw std::runtime_error("Client requested disconnection.");
-                }
-                default: {
-                    response.data = "Unknown command.";
-                    break;
+                if (capture) {
+                    capture->packetHandled(session.clientId);
                 }
+                continue;
+            }
+            co_await commands.dispatch(session, pkt);
+            if (capture) {
+                capture->packetHandled(session.clientId);
             }
-
-            // 发送响应
-            respnsetime++;
-            clientSocketPtr->sendPacket(response);
-            std::cout<<"respnsetime=="<<respnsetime<<std::endl;
-            LOG(INFO) << "Sent response to " << clientIp << ":" << clientPort 
-                      << " (Client ID: " << clientId << ")";
         }
     } catch (const std::exception& e) {
-        LOG(INFO) << "Client " << clientIp << ":" << clientPort 
-                  << " (ID: " << clientId << ") disconnected. Reason: " << e.what();
+        LOG(INFO) << "Client " << session.clientIp << ":" << session.clientPort 
+                  << " (ID: " << session.clientId << ") disconnected. Reason: " << e.what();
+    }
+
+    // 移除客户端，发送完剩余数据后关闭连接
+    if (session.rate->throttled > 0) {
+        LOG(INFO) << "Client " << session.clientId << " had " << session.rate->throttled 
+                  << " throttled messages.";
     }
+    if (capture) {
+        capture->connectionClosed(session.clientId);
+    }
+    connectedClients.erase(session.clientId);
+    cluster->removeLocalClient(session.clientId);
+    flowControl->removeClient(session.clientId);
+    acceptor->release(session.clientIp);
+    session.conn->closeAfterFlush();
+    LOG(INFO) << "Closed client connection for " << session.clientIp << ":" << session.clientPort 
+              << " (Client ID: " << session.clientId << ")";
+}
 
-    // 移除客户端
-    {
-        std::lock_guard<std::mutex> lock(clientsMutex);
-        connectedClients.erase(clientId);
+// 在事件循环线程中登记接受线程交来的新连接，并为其启动会话协程
+void registerClient(const AcceptedClient& client) {
+    if (!serverRunning) {
+        close(client.fd);
+        acceptor->release(client.ip);
+        return;
     }
-    LOG(INFO) << "Closed client connection for " << clientIp << ":" << clientPort 
-              << " (Client ID: " << clientId << ")";
+    LOG(INFO) << "A client has connected from " << client.ip << ":" << client.port 
+              << " (Server Port: " << serverConfig.port << ").";
+
+    std::string peer = client.ip + ":" + std::to_string(client.port);
+    // 分配客户端ID并存储
+    int clientId = cluster->makeClientId(clientIdCounter++);
+    std::shared_ptr<Connection> conn = std::make_shared<Connection>(*serverLoop, client.fd, peer);
+    conn->setMaxFrameSize(serverConfig.maxFrameBytes);
+    conn->setLaneWeights(serverConfig.laneWeights);
+    // splice 转发的帧不经过会话协程，抓包时无法记录，因此抓包期间所有帧都读入内存处理
+    std::shared_ptr<ConnectionRateState> rate = rateLimiter->newConnectionState();
+    if (!capture) {
+        conn->setSpliceRouter(makeSpliceRouter(clientId, rate));
+    }
+    conn->start();
+    connectedClients.emplace(clientId, std::make_pair(conn, peer));
+    cluster->addLocalClient(clientId, peer);
+    if (capture) {
+        capture->connectionOpened(clientId, peer);
+    }
+
+    // 为该客户端连接启动会话协程（不创建线程）
+    spawn(clientSession(Session{clientId, conn, client.ip, client.port, rate, std::string()}));
+}
+
+// 周期性输出限流和接受连接统计（有变化时），开启 --spin 时还有事件循环的等待统计
+void scheduleStatsReport(EventLoop& loop) {
+    if (serverConfig.statsIntervalSec <= 0) {
+        return;
+    }
+    loop.runAfter(serverConfig.statsIntervalSec * 1000, [&loop] {
+        static std::string lastReport;
+        static std::string lastAcceptReport;
+        std::string report = rateLimiter->describeStats();
+        if (report != lastReport) {
+            LOG(INFO) << "Rate limiting: " << report;
+            lastReport = report;
+        }
+        std::string acceptReport = acceptor->describeStats();
+        if (acceptReport != lastAcceptReport) {
+            LOG(INFO) << "Accept: " << acceptReport;
+            lastAcceptReport = acceptReport;
+        }
+        if (serverConfig.spinUs > 0) {
+            LOG(INFO) << "Event loop: " << loop.describeWaitStats();
+        }
+        scheduleStatsReport(loop);
+    });
 }
 
 int main(int argc, char* argv[]) {
     // 初始化glog
     GlogWrapper glog(argv[0]);
-    LOG(INFO) << "Server starting on port " << SERVER_PORT << "...";
+
+    // 解析命令行参数
+    try {
+        serverConfig = ServerConfig::fromArgs(argc, argv);
+    } catch (const std::exception& e) {
+        LOG(ERROR) << e.what();
+        std::cerr << ServerConfig::usage(argv[0]);
+        return -1;
+    }
+    // 主线程就是事件循环线程：先绑核，之后分配的连接状态、缓冲区都落在本地 NUMA 节点
+    pinCurrentThread(serverConfig.ioCpus, "event loop");
+    rateLimiter.reset(new RateLimiter(serverConfig));
+    flowControl.reset(new FlowControl(serverConfig, [](int sender, int receiver, Packet&& message) {
+        auto it = connectedClients.find(receiver);
+        if (it == connectedClients.end()) {
+            return false;
+        }
+        return it->second.first->send(message);
+    }, isReceiverReady));
+    if (!serverConfig.capturePath.empty()) {
+        try {
+            capture.reset(new CaptureWriter(serverConfig.capturePath, serverConfig.workerCpus));
+        } catch (const std::exception& e) {
+            LOG(ERROR) << e.what();
+            return -1;
+        }
+        LOG(INFO) << "Capturing inbound traffic to " << serverConfig.capturePath;
+    }
+    if (serverConfig.validateText) {
+        LOG(INFO) << "Validating chat text with the " << textScanImplementation() << " scanner.";
+    }
+    LOG(INFO) << "Server starting on port " << serverConfig.port 
+              << (serverConfig.nodeId != 0 ? " as cluster node " + std::to_string(serverConfig.nodeId) : "") << "...";
 
     // 注册信号处理函数
     std::signal(SIGINT, exitHandler);  // Ctrl + C
@@ -180,120 +587,118 @@ int main(int argc, char* argv[]) {
     // 创建socket
     serverSocket = socket(AF_INET, SOCK_STREAM, 0);
     if (serverSocket < 0) {
-        LOG(ERROR) << "Failed to create socket on port " << SERVER_PORT;
+        LOG(ERROR) << "Failed to create socket on port " << serverConfig.port;
         return -1;
     }
-    LOG(INFO) << "Socket created successfully on port " << SERVER_PORT << ".";
+    LOG(INFO) << "Socket created successfully on port " << serverConfig.port << ".";
 
     // 设置服务器地址信息
     memset(&serverAddress, 0, sizeof(serverAddress));
     serverAddress.sin_family = AF_INET;
     serverAddress.sin_addr.s_addr = INADDR_ANY; // 接受任意本地网卡IP
-    serverAddress.sin_port = htons(SERVER_PORT);
+    serverAddress.sin_port = htons(serverConfig.port);
+
+    // 允许重启后立即重新绑定处于 TIME_WAIT 的端口
+    int reuse = 1;
+    setsockopt(serverSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
 
     // 绑定socket到本地地址
     if (bind(serverSocket, (struct sockaddr*)&serverAddress, sizeof(serverAddress)) < 0) {
-        LOG(ERROR) << "Binding failed on port " << SERVER_PORT;
+        LOG(ERROR) << "Binding failed on port " << serverConfig.port;
         close(serverSocket);
         return -1;
     }
-    LOG(INFO) << "Binding successful on port " << SERVER_PORT;
+    LOG(INFO) << "Binding successful on port " << serverConfig.port;
 
     // 开始监听客户端连接请求
-    if (listen(serverSocket, MAX_CLIENT_QUEUE) < 0) {
-        LOG(ERROR) << "Listening failed on port " << SERVER_PORT;
+    if (listen(serverSocket, serverConfig.listenBacklog) < 0) {
+        LOG(ERROR) << "Listening failed on port " << serverConfig.port;
         close(serverSocket);
         return -1;
     }
-    LOG(INFO) << "Server listening on port " << SERVER_PORT 
-              << " with max queue: " << MAX_CLIENT_QUEUE;
-
-    // 为处理客户端请求创建线程容器
-    std::vector<std::thread> threads;
-
-    while (serverRunning) {
-        struct sockaddr_in clientAddress;
-        socklen_t addressLength = sizeof(clientAddress);
-
-        // 使用select设置非阻塞模式，以便能够定期检查serverRunning
-        fd_set set;
-        struct timeval timeout;
-        FD_ZERO(&set);
-        FD_SET(serverSocket, &set);
-        timeout.tv_sec = 1; // 1秒超时
-        timeout.tv_usec = 0;
-        int rv = select(serverSocket + 1, &set, NULL, NULL, &timeout);
-        if (rv == -1) {
-            if (serverRunning) {
-                LOG(ERROR) << "Select error.";
-            }
-            break;
-        } else if (rv == 0) {
-            // 超时，继续检查serverRunning
-            continue;
-        } else {
-            if (FD_ISSET(serverSocket, &set)) {
-                int clientFd = accept(serverSocket, (struct sockaddr*)&clientAddress, &addressLength);
-
-                if (clientFd < 0) {
-                    if (serverRunning) {
-                        LOG(ERROR) << "A client failed to connect to server port " << SERVER_PORT << ".";
-                    }
-                    continue;
-                } else {
-                    std::string clientIp = inet_ntoa(clientAddress.sin_addr);
-                    int clientPort = ntohs(clientAddress.sin_port);
-                    LOG(INFO) << "A client has connected from " << clientIp << ":" << clientPort 
-                              << " (Server Port: " << SERVER_PORT << ").";
-
-                    // 封装客户端Socket为 shared_ptr
-                    std::shared_ptr<MySocket> clientSocketPtr = std::make_shared<MySocket>(clientFd);
-
-                    // 分配客户端ID并存储
-                    int clientId;
-                    {
-                        std::lock_guard<std::mutex> lock(clientsMutex);
-                        clientId = clientIdCounter++;
-                        connectedClients.emplace(clientId, std::make_pair(clientSocketPtr, clientIp + ":" + std::to_string(clientPort)));
-                    }
-
-                    // 为该客户端连接创建新线程进行处理
-                    threads.emplace_back(handleClient, clientId, clientSocketPtr, clientIp, clientPort);
-                }
-            }
+    // 三次握手完成后不立即唤醒接受线程，等客户端发来第一个请求
+    if (serverConfig.deferAcceptSec > 0) {
+        int deferSec = static_cast<int>(serverConfig.deferAcceptSec);
+        if (setsockopt(serverSocket, IPPROTO_TCP, TCP_DEFER_ACCEPT, &deferSec, sizeof(deferSec)) < 0) {
+            LOG(ERROR) << "Failed to set TCP_DEFER_ACCEPT on port " << serverConfig.port << ": " << strerror(errno);
         }
     }
+    LOG(INFO) << "Server listening on port " << serverConfig.port 
+              << " with max queue: " << serverConfig.listenBacklog;
 
-    // 关闭服务器socket
+    // 注册各消息类型的协程处理函数
+    commands.on(GET_TIME, handleGetTime);
+    commands.on(GET_NAME, handleGetName);
+    commands.on(SEND_MESSAGE, handleSendMessage);
+    commands.on(LIST_CLIENTS, handleListClients);
+    commands.on(GRANT_CREDIT, handleGrantCredit);
+    commands.on(STREAM_CHUNK, handleStreamChunk);
+    commands.on(HELLO, handleHello);
+    commands.on(DISCONNECT, handleDisconnect);
+    commands.otherwise(handleUnknown);
+
+    // 所有连接都由同一个事件循环驱动，不再为每个客户端创建线程；
+    // 接受连接在单独的线程中批量完成，事件循环每批只被唤醒一次
+    fcntl(serverSocket, F_SETFL, fcntl(serverSocket, F_GETFL, 0) | O_NONBLOCK);
+    EventLoop loop;
+    loop.setSpin(serverConfig.spinUs);
+    if (serverConfig.busyPollUs > 0) {
+        loop.setBusyPoll(serverConfig.busyPollUs);
+    }
+    serverLoop = &loop;
+    acceptor.reset(new Acceptor(loop, serverSocket, serverConfig, registerClient));
+    cluster.reset(new Cluster(loop, serverConfig, submitLocal, [](int clientId) {
+        flowControl->removeClient(clientId); // 远程客户端离线
+    }, [](int clientId) -> std::shared_ptr<Connection> {
+        auto it = connectedClients.find(clientId);
+        return it == connectedClients.end() ? nullptr : it->second.first;
+    }));
+    try {
+        cluster->start();
+    } catch (const std::exception& e) {
+        LOG(ERROR) << e.what();
+        close(serverSocket);
+        return -1;
+    }
+    acceptor->start();
+    scheduleStatsReport(loop);
+    if (serverRunning) {
+        loop.run();
+    }
+    serverLoop = nullptr;
+
+    // 关闭服务器socket和集群连接
+    acceptor->stop();
+    cluster->stop();
     close(serverSocket);
-    LOG(INFO) << "Server socket closed. Waiting for client threads to finish...";
+    LOG(INFO) << "Server socket closed. Disconnecting clients...";
 
     // 向所有连接的客户端发送DISCONNECT消息并关闭它们的socket
-    {
-        std::lock_guard<std::mutex> lock(clientsMutex);
-        for (auto& [id, clientPair] : connectedClients) {
-            try {
-                Packet pkt;
-                pkt.type = DISCONNECT;
-                pkt.data = "Server shutting down.";
-                clientPair.first->sendPacket(pkt);
-                // 关闭socket
-                close(clientPair.first->getFd());
-                LOG(INFO) << "Sent DISCONNECT to Client " << id;
-            } catch (const std::exception& e) {
-                LOG(ERROR) << "Error disconnecting client " << id << ": " << e.what();
-            }
+    for (auto& [id, clientPair] : connectedClients) {
+        Packet pkt;
+        pkt.type = DISCONNECT;
+        pkt.data = "Server shutting down.";
+        if (clientPair.first->send(pkt)) {
+            clientPair.first->flushBlocking(SHUTDOWN_FLUSH_TIMEOUT_MS);
+            LOG(INFO) << "Sent DISCONNECT to Client " << id;
+        } else {
+            LOG(ERROR) << "Error disconnecting client " << id << ": connection already closed.";
         }
-        connectedClients.clear();
+        clientPair.first->close("Server shutting down.");
     }
+    connectedClients.clear();
+    cluster.reset();
 
-    // 等待所有线程结束
-    for (auto& t : threads) {
-        if (t.joinable()) {
-            t.join();
-        }
+    LOG(INFO) << "Rate limiting: " << rateLimiter->describeStats();
+    LOG(INFO) << "Accept: " << acceptor->describeStats();
+    if (serverConfig.spinUs > 0) {
+        LOG(INFO) << "Event loop: " << loop.describeWaitStats();
+    }
+    if (capture) {
+        LOG(INFO) << "Capture: " << capture->recordedCount() << " records written, " 
+                  << capture->droppedCount() << " dropped.";
+        capture.reset();
     }
-
     LOG(INFO) << "Server shut down gracefully.";
     return 0;
 }
@@ -0,0 +1,274 @@
+// ServerConfig.cpp
+
+#include "ServerConfig.h"
+#include <cstdlib>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include <sched.h>
+
+#define MIN_MAX_FRAME_BYTES 4096
+#define MAX_POLL_US 100000 // --spin、--busy-poll 的上限
+
+namespace {
+
+std::vector<std::string> split(const std::string& value, char delimiter) {
+    std::vector<std::string> parts;
+    std::stringstream ss(value);
+    std::string part;
+    while (std::getline(ss, part, delimiter)) {
+        parts.push_back(part);
+    }
+    return parts;
+}
+
+std::vector<std::string> splitColon(const std::string& value) {
+    return split(value, ':');
+}
+
+uint32_t parseUint(const std::string& name, const std::string& text) {
+    char* end = nullptr;
+    unsigned long long value = std::strtoull(text.c_str(), &end, 10);
+    if (text.empty() || *end != '\0' || value > UINT32_MAX) {
+        throw std::invalid_argument("Invalid value for --" + name + ": " + text);
+    }
+    return static_cast<uint32_t>(value);
+}
+
+RateSpec parseRate(const std::string& name, const std::string& text) {
+    std::vector<std::string> parts = splitColon(text);
+    if (parts.size() != 2) {
+        throw std::invalid_argument("Expected RATE:BURST for --" + name + ": " + text);
+    }
+    RateSpec spec{parseUint(name, parts[0]), parseUint(name, parts[1])};
+    // 桶容量为 0 时令牌桶会放行一切：只有 RATE 为 0 才表示不限
+    if (spec.rate != 0 && spec.burst == 0) {
+        throw std::invalid_argument("BURST must be positive when RATE is not 0 for --" + name + ": " + text);
+    }
+    return spec;
+}
+
+uint16_t parsePort(const std::string& name, const std::string& text) {
+    uint32_t port = parseUint(name, text);
+    if (port == 0 || port > 65535) {
+        throw std::invalid_argument("Invalid port for --" + name + ": " + text);
+    }
+    return static_cast<uint16_t>(port);
+}
+
+// ID@HOST:PORT[,ID@HOST:PORT...]
+std::vector<PeerAddress> parsePeers(const std::string& text) {
+    std::vector<PeerAddress> peers;
+    for (const std::string& item : split(text, ',')) {
+        size_t at = item.find('@');
+        size_t colon = item.rfind(':');
+        if (at == std::string::npos || colon == std::string::npos || colon < at) {
+            throw std::invalid_argument("Expected ID@HOST:PORT for --peers: " + item);
+        }
+        PeerAddress peer;
+        peer.nodeId = static_cast<int>(parseUint("peers", item.substr(0, at)));
+        peer.host = item.substr(at + 1, colon - at - 1);
+        peer.port = parsePort("peers", item.substr(colon + 1));
+        peers.push_back(peer);
+    }
+    return peers;
+}
+
+// 0-3,8,10-11
+std::vector<int> parseCpuList(const std::string& name, const std::string& text) {
+    std::vector<int> cpus;
+    for (const std::string& item : split(text, ',')) {
+        size_t dash = item.find('-');
+        uint32_t first = parseUint(name, item.substr(0, dash));
+        uint32_t last = dash == std::string::npos ? first : parseUint(name, item.substr(dash + 1));
+        if (last < first || last >= CPU_SETSIZE) {
+            throw std::invalid_argument("Invalid CPU range for --" + name + ": " + item);
+        }
+        for (uint32_t cpu = first; cpu <= last; cpu++) {
+            cpus.push_back(static_cast<int>(cpu));
+        }
+    }
+    if (cpus.empty()) {
+        throw std::invalid_argument("Empty CPU list for --" + name + ".");
+    }
+    return cpus;
+}
+
+uint32_t parseMessageType(const std::string& text) {
+    static const std::map<std::string, uint32_t> names = {
+        {"GET_TIME", GET_TIME},
+        {"GET_NAME", GET_NAME},
+        {"SEND_MESSAGE", SEND_MESSAGE},
+        {"DISCONNECT", DISCONNECT},
+        {"LIST_CLIENTS", LIST_CLIENTS},
+        {"GRANT_CREDIT", GRANT_CREDIT},
+        {"STREAM_CHUNK", STREAM_CHUNK},
+    };
+    auto it = names.find(text);
+    if (it != names.end()) {
+        return it->second;
+    }
+    return parseUint("type-rate", text);
+}
+
+} // namespace
+
+ServerConfig ServerConfig::fromArgs(int argc, char* argv[]) {
+    ServerConfig config;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        size_t eq = arg.find('=');
+        if (arg.compare(0, 2, "--") != 0 || eq == std::string::npos) {
+            throw std::invalid_argument("Unrecognized argument: " + arg);
+        }
+        std::string name = arg.substr(2, eq - 2);
+        std::string value = arg.substr(eq + 1);
+
+        if (name == "port") {
+            config.port = parsePort(name, value);
+        } else if (name == "node-id") {
+            config.nodeId = static_cast<int>(parseUint(name, value));
+            if (config.nodeId > MAX_NODE_ID) {
+                throw std::invalid_argument("--node-id must be at most " + std::to_string(MAX_NODE_ID));
+            }
+        } else if (name == "peer-port") {
+            config.peerPort = parsePort(name, value);
+        } else if (name == "peers") {
+            config.peers = parsePeers(value);
+        } else if (name == "gossip-interval") {
+            config.gossipIntervalMs = static_cast<int>(parseUint(name, value));
+            if (config.gossipIntervalMs == 0) {
+                throw std::invalid_argument("--gossip-interval must be positive.");
+            }
+        } else if (name == "conn-rate") {
+            config.connectionRate = parseRate(name, value);
+        } else if (name == "type-rate") {
+            // TYPE:RATE:BURST，TYPE 可以是名字或数字
+            size_t colon = value.find(':');
+            if (colon == std::string::npos) {
+                throw std::invalid_argument("Expected TYPE:RATE:BURST for --type-rate: " + value);
+            }
+            config.typeRates[parseMessageType(value.substr(0, colon))] = parseRate(name, value.substr(colon + 1));
+        } else if (name == "forward-bytes-rate") {
+            config.forwardBytesRate = parseRate(name, value);
+        } else if (name == "credit-window") {
+            RateSpec window = parseRate(name, value);
+            if (window.rate == 0 || window.burst == 0) {
+                throw std::invalid_argument("--credit-window must be positive: " + value);
+            }
+            config.creditMessages = window.rate;
+            config.creditBytes = window.burst;
+        } else if (name == "receiver-max-inflight") {
+            config.receiverMaxInFlightBytes = parseUint(name, value);
+        } else if (name == "sender-max-queued") {
+            config.senderMaxQueuedBytes = parseUint(name, value);
+        } else if (name == "pair-max-queued") {
+            config.pairMaxQueuedMessages = parseUint(name, value);
+        } else if (name == "max-frame") {
+            config.maxFrameBytes = parseUint(name, value);
+            if (config.maxFrameBytes < MIN_MAX_FRAME_BYTES) {
+                throw std::invalid_argument("--max-frame must be at least " + std::to_string(MIN_MAX_FRAME_BYTES) + ".");
+            }
+        } else if (name == "compress-min") {
+            config.compressMinBytes = parseUint(name, value);
+        } else if (name == "validate-text") {
+            config.validateText = parseUint(name, value) != 0;
+        } else if (name == "backlog") {
+            config.listenBacklog = parseUint(name, value);
+            if (config.listenBacklog == 0) {
+                throw std::invalid_argument("--backlog must be positive.");
+            }
+        } else if (name == "defer-accept") {
+            config.deferAcceptSec = parseUint(name, value);
+        } else if (name == "max-connections") {
+            config.maxConnections = parseUint(name, value);
+        } else if (name == "max-per-ip") {
+            config.maxConnectionsPerIp = parseUint(name, value);
+        } else if (name == "lane-weights") {
+            std::vector<std::string> parts = splitColon(value);
+            if (parts.size() != config.laneWeights.size()) {
+                throw std::invalid_argument("Expected CONTROL:RESPONSE:BULK for --lane-weights: " + value);
+            }
+            for (size_t lane = 0; lane < parts.size(); lane++) {
+                config.laneWeights[lane] = parseUint(name, parts[lane]);
+                if (config.laneWeights[lane] == 0 || config.laneWeights[lane] > 1024) {
+                    throw std::invalid_argument("--lane-weights must be between 1 and 1024: " + value);
+                }
+            }
+        } else if (name == "io-cpus") {
+            config.ioCpus = parseCpuList(name, value);
+        } else if (name == "accept-cpus") {
+            config.acceptCpus = parseCpuList(name, value);
+        } else if (name == "worker-cpus") {
+            config.workerCpus = parseCpuList(name, value);
+        } else if (name == "busy-poll") {
+            config.busyPollUs = parseUint(name, value);
+            if (config.busyPollUs > MAX_POLL_US) {
+                throw std::invalid_argument("--busy-poll must be at most " + std::to_string(MAX_POLL_US) + " microseconds.");
+            }
+        } else if (name == "spin") {
+            config.spinUs = parseUint(name, value);
+            if (config.spinUs > MAX_POLL_US) {
+                throw std::invalid_argument("--spin must be at most " + std::to_string(MAX_POLL_US) + " microseconds.");
+            }
+        } else if (name == "capture") {
+            config.capturePath = value;
+        } else if (name == "stats-interval") {
+            config.statsIntervalSec = static_cast<int>(parseUint(name, value));
+        } else {
+            throw std::invalid_argument("Unknown option: --" + name);
+        }
+    }
+
+    if (config.nodeId == 0 && (config.peerPort != 0 || !config.peers.empty())) {
+        throw std::invalid_argument("--peer-port and --peers require --node-id.");
+    }
+    if (config.nodeId != 0 && config.peerPort == 0) {
+        throw std::invalid_argument("--node-id requires --peer-port.");
+    }
+    // 允许所有节点使用同一个 --peers 列表：忽略其中的本节点
+    std::vector<PeerAddress> others;
+    for (const PeerAddress& peer : config.peers) {
+        if (peer.nodeId == 0 || peer.nodeId > MAX_NODE_ID) {
+            throw std::invalid_argument("Invalid peer node ID: " + std::to_string(peer.nodeId));
+        }
+        if (peer.nodeId != config.nodeId) {
+            others.push_back(peer);
+        }
+    }
+    config.peers = others;
+    return config;
+}
+
+std::string ServerConfig::usage(const char* program) {
+    std::ostringstream out;
+    out << "Usage: " << program << " [options]\n"
+        << "  --port=PORT                       client listening port (default 5869)\n"
+        << "  --node-id=N                       enable cluster mode as node N (1-" << MAX_NODE_ID << ")\n"
+        << "  --peer-port=PORT                  port for links from other nodes\n"
+        << "  --peers=ID@HOST:PORT,...          cluster nodes and their peer ports (own entry is ignored)\n"
+        << "  --gossip-interval=MS              client directory anti-entropy interval\n"
+        << "  --conn-rate=RATE:BURST            messages/sec per connection (RATE 0 = unlimited, otherwise BURST >= 1)\n"
+        << "  --type-rate=TYPE:RATE:BURST       messages/sec per connection for one message type\n"
+        << "  --forward-bytes-rate=RATE:BURST   forwarded bytes/sec for the whole server\n"
+        << "  --credit-window=MSGS:BYTES        forwarding credit per (sender, receiver) pair\n"
+        << "  --receiver-max-inflight=BYTES     unacknowledged forwarded bytes per receiver\n"
+        << "  --sender-max-queued=BYTES         bytes a sender may have queued on the server\n"
+        << "  --pair-max-queued=MSGS            messages queued per (sender, receiver) pair\n"
+        << "  --max-frame=BYTES                 largest packet kept in memory (use STREAM_CHUNK for more)\n"
+        << "  --compress-min=BYTES              compress packets of at least BYTES on negotiated connections (0 = off)\n"
+        << "  --validate-text=0|1               reject chat messages that are not UTF-8 or contain control characters (default 1)\n"
+        << "  --backlog=N                       listen queue length (default 4096, capped by somaxconn)\n"
+        << "  --defer-accept=SEC                accept only after the client sends data (0 = off)\n"
+        << "  --max-connections=N               concurrent client connections (0 = unlimited)\n"
+        << "  --max-per-ip=N                    concurrent client connections per IP (0 = unlimited)\n"
+        << "  --lane-weights=C:R:B              outbound weights of control, response and bulk traffic (default 8:4:1)\n"
+        << "  --io-cpus=LIST                    pin the event loop thread to CPUs, e.g. 0-3,8 (memory from their NUMA node)\n"
+        << "  --accept-cpus=LIST                pin the accept thread to CPUs\n"
+        << "  --worker-cpus=LIST                pin background worker threads (capture writer) to CPUs\n"
+        << "  --busy-poll=US                    SO_BUSY_POLL on client sockets and the event loop (0 = off)\n"
+        << "  --spin=US                         poll for US microseconds before blocking in the event loop (0 = off)\n"
+        << "  --capture=PATH                    record every inbound packet to PATH for the replay tool (disables splice relaying)\n"
+        << "  --stats-interval=SEC              throttling statistics log interval (0 = on exit only)\n";
+    return out.str();
+}
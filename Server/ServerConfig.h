@@ -0,0 +1,88 @@
+// ServerConfig.h
+// 服务器运行参数，通过命令行 --key=value 配置
+#ifndef SERVERCONFIG_H
+#define SERVERCONFIG_H
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include "Message/MySocket.h"
+
+// 限流参数：rate 为每秒补充量（0 表示不限），burst 为桶容量
+struct RateSpec {
+    uint32_t rate;
+    uint32_t burst;
+};
+
+// 集群模式下客户端 ID = 节点号 * NODE_ID_STRIDE + 节点内序号，由 ID 即可确定所属节点
+#define NODE_ID_STRIDE 1000000
+#define MAX_NODE_ID 2000 // 保证客户端 ID 不超出 int 范围
+
+// 集群中的一个对端节点
+struct PeerAddress {
+    int nodeId;
+    std::string host;
+    uint16_t port;
+};
+
+struct ServerConfig {
+    // 客户端监听端口
+    uint16_t port = 5869;
+    // 集群模式：nodeId 为 0 表示单机运行；非 0 时在 peerPort 上接受其他节点的连接，
+    // 并主动连接 peers 中节点号比自己大的节点（节点号小的一方负责发起连接）
+    int nodeId = 0;
+    uint16_t peerPort = 0;
+    std::vector<PeerAddress> peers;
+    int gossipIntervalMs = 1000; // 客户端目录反熵同步间隔
+    // 每连接的消息速率（默认值能容纳自带客户端一次连发 100 个 GET_TIME）
+    RateSpec connectionRate = {2000, 500};
+    // 每连接、每消息类型的速率
+    std::map<uint32_t, RateSpec> typeRates = {
+        {SEND_MESSAGE, {200, 100}},
+        {LIST_CLIENTS, {20, 10}},
+    };
+    // 全局转发字节速率
+    RateSpec forwardBytesRate = {64u << 20, 8u << 20};
+    // 转发消息的信用流控
+    uint32_t creditMessages = 64;                  // 每对 (发送方, 接收方) 的消息窗口
+    uint64_t creditBytes = 256u << 10;             // 每对的字节窗口
+    uint64_t receiverMaxInFlightBytes = 4u << 20;  // 每个接收方未确认的转发字节上限
+    uint64_t senderMaxQueuedBytes = 1u << 20;      // 每个发送方在服务器排队的字节上限
+    uint32_t pairMaxQueuedMessages = 256;          // 每对最多排队的消息数
+    // 单个数据包数据部分的上限（字节），更大的内容须用 STREAM_CHUNK 分块发送
+    uint32_t maxFrameBytes = 1u << 20;
+    // 协商了压缩的连接上，不少于该字节数的数据包才压缩；0 表示拒绝所有压缩协商
+    uint32_t compressMinBytes = 64;
+    // 拒绝不是合法 UTF-8 或含控制字符的聊天消息（它们会原样显示在接收方的终端上，见 Message/Scan.h）
+    bool validateText = true;
+    // 监听队列长度（实际还受 net.core.somaxconn 限制）
+    uint32_t listenBacklog = 4096;
+    // TCP_DEFER_ACCEPT 秒数：客户端发来第一个字节后才算接受完成；0 表示不启用
+    uint32_t deferAcceptSec = 0;
+    // 准入控制：同时在线的客户端连接数上限和单个 IP 的连接数上限，0 表示不限
+    uint32_t maxConnections = 10000;
+    uint32_t maxConnectionsPerIp = 0;
+    // 发送队列各车道（控制:请求/响应:批量）的权重，见 Connection.h
+    std::array<uint32_t, 3> laneWeights = {{8, 4, 1}};
+    // 线程绑核（见 CpuAffinity.h）：事件循环、接受线程、后台工作线程各自的 CPU 列表，空表示不绑定
+    std::vector<int> ioCpus;
+    std::vector<int> acceptCpus;
+    std::vector<int> workerCpus;
+    // 低延迟模式，以 CPU 换尾延迟：
+    // busyPollUs 为客户端 socket 的 SO_BUSY_POLL 微秒数（内核支持时事件循环的 epoll 也忙轮询网卡队列），
+    // spinUs 为事件循环在阻塞等待前先以 0 超时轮询的微秒数（spin-then-park）；0 表示不启用
+    uint32_t busyPollUs = 0;
+    uint32_t spinUs = 0;
+    // 非空时把收到的每个数据包记录到该抓包文件（供 replay 工具重放）
+    std::string capturePath;
+    // 统计日志输出间隔（秒），0 表示只在退出时输出
+    int statsIntervalSec = 10;
+
+    // 解析命令行参数，参数非法时抛出 std::invalid_argument
+    static ServerConfig fromArgs(int argc, char* argv[]);
+    static std::string usage(const char* program);
+};
+
+#endif // SERVERCONFIG_H
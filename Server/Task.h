@@ -0,0 +1,102 @@
+// Task.h
+// 服务器命令处理使用的协程类型
+#ifndef TASK_H
+#define TASK_H
+
+#include <coroutine>
+#include <exception>
+#include <utility>
+#include <glog/logging.h>
+
+// 惰性启动的协程任务：
+// - co_await task：启动 task 并在其结束后恢复调用者，task 中的异常会重新抛出
+// - spawn(task)：独立运行，结束时自行销毁（未处理的异常只记录日志）
+class Task {
+public:
+    struct promise_type {
+        std::coroutine_handle<> continuation;
+        std::exception_ptr exception;
+        bool detached = false;
+
+        Task get_return_object() {
+            return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        struct FinalAwaiter {
+            bool await_ready() noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept {
+                promise_type& p = h.promise();
+                if (p.continuation) {
+                    return p.continuation;
+                }
+                if (p.detached) {
+                    if (p.exception) {
+                        try {
+                            std::rethrow_exception(p.exception);
+                        } catch (const std::exception& e) {
+                            LOG(ERROR) << "Unhandled exception in detached task: " << e.what();
+                        } catch (...) {
+                            LOG(ERROR) << "Unhandled unknown exception in detached task.";
+                        }
+                    }
+                    h.destroy();
+                }
+                return std::noop_coroutine();
+            }
+            void await_resume() noexcept {}
+        };
+        FinalAwaiter final_suspend() noexcept { return {}; }
+
+        void return_void() {}
+        void unhandled_exception() { exception = std::current_exception(); }
+    };
+
+    typedef std::coroutine_handle<promise_type> Handle;
+
+    Task(Task&& other) noexcept : handle(std::exchange(other.handle, {})) {}
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            if (handle) {
+                handle.destroy();
+            }
+            handle = std::exchange(other.handle, {});
+        }
+        return *this;
+    }
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    ~Task() {
+        if (handle) {
+            handle.destroy();
+        }
+    }
+
+    bool await_ready() const noexcept { return !handle || handle.done(); }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        handle.promise().continuation = awaiting;
+        return handle;
+    }
+    void await_resume() {
+        if (handle && handle.promise().exception) {
+            std::rethrow_exception(handle.promise().exception);
+        }
+    }
+
+    // 独立运行一个任务
+    friend void spawn(Task task) {
+        Handle h = std::exchange(task.handle, {});
+        if (h) {
+            h.promise().detached = true;
+            h.resume();
+        }
+    }
+
+private:
+    explicit Task(Handle h) : handle(h) {}
+
+    Handle handle;
+};
+
+#endif // TASK_H
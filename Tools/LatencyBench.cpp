@@ -0,0 +1,230 @@
+// LatencyBench.cpp
+// 测量请求往返延迟，用于比较服务器的运行模式（默认、绑核、--spin、--busy-poll，见 run_bench.sh）
+//
+// 用法: latency_bench [--host=127.0.0.1] [--port=5869] [--connections=1] [--requests=20000]
+//                     [--warmup=1000] [--gap-us=100] [--spin=0|1] [--busy-poll=US]
+// - 每个连接一个线程，一次只有一个 GET_TIME 在途；收到响应后等待 gap-us 再发下一个。
+//   请求之间有空隙时服务器的事件循环会睡眠，--spin / --busy-poll 要省掉的正是这次唤醒
+// - --spin=1 时客户端用非阻塞 recv 忙等响应（空隙也忙等），排除客户端自己的唤醒延迟；
+//   --busy-poll 设置客户端 socket 的 SO_BUSY_POLL
+// - 服务器默认的每连接限流会拒绝高速请求（单独计数，不计入延迟），测试时请用 --conn-rate=0:0 启动服务器
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "Message/FrameDecoder.h"
+#include "Message/MySocket.h"
+
+#define BENCH_READ_CHUNK 4096
+#define BENCH_THROTTLED_PREFIX "Rate limit exceeded"
+
+typedef std::chrono::steady_clock Clock;
+
+struct BenchOptions {
+    std::string host = "127.0.0.1";
+    uint16_t port = 5869;
+    int connections = 1;
+    int requests = 20000; // 每个连接
+    int warmup = 1000;    // 每个连接先发的、不计入统计的请求数
+    int gapUs = 100;
+    bool spin = false;
+    int busyPollUs = 0;
+};
+
+struct BenchResult {
+    std::vector<uint64_t> samples; // 纳秒
+    uint64_t throttled = 0;
+    std::string error;
+};
+
+static BenchOptions parseArgs(int argc, char* argv[]) {
+    BenchOptions options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        size_t eq = arg.find('=');
+        if (arg.compare(0, 2, "--") != 0 || eq == std::string::npos) {
+            throw std::invalid_argument("Unrecognized argument: " + arg);
+        }
+        std::string name = arg.substr(2, eq - 2);
+        std::string value = arg.substr(eq + 1);
+        if (name == "host") {
+            options.host = value;
+        } else if (name == "port") {
+            options.port = static_cast<uint16_t>(std::atoi(value.c_str()));
+        } else if (name == "connections") {
+            options.connections = std::atoi(value.c_str());
+        } else if (name == "requests") {
+            options.requests = std::atoi(value.c_str());
+        } else if (name == "warmup") {
+            options.warmup = std::atoi(value.c_str());
+        } else if (name == "gap-us") {
+            options.gapUs = std::atoi(value.c_str());
+        } else if (name == "spin") {
+            options.spin = std::atoi(value.c_str()) != 0;
+        } else if (name == "busy-poll") {
+            options.busyPollUs = std::atoi(value.c_str());
+        } else {
+            throw std::invalid_argument("Unknown option: --" + name);
+        }
+    }
+    if (options.connections <= 0 || options.requests <= 0 || options.warmup < 0 || options.gapUs < 0) {
+        throw std::invalid_argument("--connections and --requests must be positive, --warmup and --gap-us not negative.");
+    }
+    return options;
+}
+
+static int connectTo(const BenchOptions& options) {
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* result = nullptr;
+    if (getaddrinfo(options.host.c_str(), std::to_string(options.port).c_str(), &hints, &result) != 0) {
+        throw std::runtime_error("Failed to resolve " + options.host);
+    }
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, result->ai_addr, result->ai_addrlen) < 0) {
+        freeaddrinfo(result);
+        if (fd >= 0) {
+            close(fd);
+        }
+        throw std::runtime_error(std::string("Failed to connect: ") + strerror(errno));
+    }
+    freeaddrinfo(result);
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (options.busyPollUs > 0 &&
+        setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &options.busyPollUs, sizeof(options.busyPollUs)) < 0) {
+        std::cerr << "SO_BUSY_POLL failed: " << strerror(errno) << std::endl;
+    }
+    return fd;
+}
+
+static bool readPacket(int fd, FrameDecoder& decoder, Packet& pkt, bool spin) {
+    char buffer[BENCH_READ_CHUNK];
+    while (!decoder.next(pkt)) {
+        ssize_t n = recv(fd, buffer, sizeof(buffer), spin ? MSG_DONTWAIT : 0);
+        if (n > 0) {
+            decoder.append(buffer, n);
+        } else if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void waitGap(int gapUs, bool spin) {
+    if (gapUs == 0) {
+        return;
+    }
+    if (!spin) {
+        std::this_thread::sleep_for(std::chrono::microseconds(gapUs));
+        return;
+    }
+    Clock::time_point until = Clock::now() + std::chrono::microseconds(gapUs);
+    while (Clock::now() < until) {
+    }
+}
+
+static void runConnection(const BenchOptions& options, BenchResult& result) {
+    try {
+        int fd = connectTo(options);
+        Packet request;
+        request.type = GET_TIME;
+        const std::string frame = request.serialize();
+        FrameDecoder decoder;
+        Packet response;
+        result.samples.reserve(options.requests);
+        for (int i = 0; i < options.warmup + options.requests; i++) {
+            waitGap(options.gapUs, options.spin);
+            Clock::time_point sent = Clock::now();
+            if (::send(fd, frame.data(), frame.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(frame.size())) {
+                throw std::runtime_error(std::string("send failed: ") + strerror(errno));
+            }
+            if (!readPacket(fd, decoder, response, options.spin)) {
+                throw std::runtime_error("Connection closed by server.");
+            }
+            uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - sent).count();
+            if (response.data.compare(0, strlen(BENCH_THROTTLED_PREFIX), BENCH_THROTTLED_PREFIX) == 0) {
+                result.throttled++;
+            } else if (i >= options.warmup) {
+                result.samples.push_back(ns);
+            }
+        }
+        close(fd);
+    } catch (const std::exception& e) {
+        result.error = e.what();
+    }
+}
+
+static double cpuSeconds() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+    try {
+        options = parseArgs(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n"
+                  << "Usage: " << argv[0] << " [--host=127.0.0.1] [--port=5869] [--connections=1] "
+                  << "[--requests=20000] [--warmup=1000] [--gap-us=100] [--spin=0|1] [--busy-poll=US]" << std::endl;
+        return -1;
+    }
+
+    std::vector<BenchResult> results(options.connections);
+    std::vector<std::thread> threads;
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < options.connections; i++) {
+        threads.emplace_back(runConnection, std::cref(options), std::ref(results[i]));
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::vector<uint64_t> samples;
+    uint64_t throttled = 0;
+    int failed = 0;
+    for (const BenchResult& result : results) {
+        samples.insert(samples.end(), result.samples.begin(), result.samples.end());
+        throttled += result.throttled;
+        if (!result.error.empty()) {
+            std::cerr << "Connection failed: " << result.error << std::endl;
+            failed++;
+        }
+    }
+    if (samples.empty()) {
+        std::cerr << "No samples collected." << std::endl;
+        return 1;
+    }
+    std::sort(samples.begin(), samples.end());
+    auto at = [&samples](double q) {
+        size_t index = static_cast<size_t>(q * (samples.size() - 1) + 0.5);
+        return samples[index] / 1000.0;
+    };
+    char line[256];
+    snprintf(line, sizeof(line), "%8zu %10.1f %10.1f %10.1f %10.1f %10.1f %10.0f %10.2f", samples.size(),
+             at(0.5), at(0.9), at(0.99), at(0.999), samples.back() / 1000.0, samples.size() / elapsed, cpuSeconds());
+    std::cout << "   count    p50(us)    p90(us)    p99(us)  p99.9(us)    max(us)      req/s  client_cpu" << std::endl;
+    std::cout << line << std::endl;
+    if (throttled > 0) {
+        std::cout << "Throttled responses: " << throttled << " (start the server with --conn-rate=0:0)" << std::endl;
+    }
+    return failed == 0 && throttled == 0 ? 0 : 1;
+}
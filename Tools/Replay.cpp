@@ -0,0 +1,552 @@
+// Replay.cpp
+// 重放服务器 --capture 记录的流量，统计响应延迟分布并与原始运行对比
+//
+// 用法: replay --capture=FILE [--host=127.0.0.1] [--port=5869] [--speed=1|N|max] [--id-base=1]
+//       replay --capture=FILE --compare=FILE
+// - 抓包中的每个客户端连接对应一个重放连接（全部由一个 epoll 线程并发驱动），
+//   按记录的时间（除以 speed）建立连接、发送数据包；max 表示不等待，每个连接按顺序尽快发送
+// - 服务器按建立顺序分配客户端 ID：请对新启动的服务器重放（集群节点 N 的 id-base 为 N*1000000+1）。
+//   重放连接按原顺序依次建立，第 i 个连接的 ID 为 id-base + i，SEND_MESSAGE / STREAM_CHUNK 中的目标 ID 据此改写
+// - 对比的是同一个量：服务器开始处理请求到处理完成。原始值取自抓包（FRAME 到 DONE），
+//   重放的请求都带追踪（见 Message/Trace.h），取响应中的 dispatch -> enqueue 时间戳；
+//   另外单独列出重放时客户端发出到收到响应的往返时间。只统计有响应的请求（GRANT_CREDIT、STREAM_CHUNK 没有响应）
+// - 追踪的终点（响应入队）比抓包的 DONE 略早（不含之后的日志）。需要完全相同的口径时，重放时让服务器也抓包，
+//   结束后用 --compare 只对比两个抓包文件的 FRAME -> DONE 分布，不建立连接
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "Message/Capture.h"
+#include "Message/Compression.h"
+#include "Message/Fragment.h"
+#include "Message/FrameDecoder.h"
+#include "Message/StreamChunk.h"
+#include "Message/Trace.h"
+
+#define REPLAY_MAX_EVENTS 256
+#define REPLAY_READ_CHUNK 65536
+#define REPLAY_DRAIN_TIMEOUT_MS 5000 // 发送完后等待剩余响应的最长时间
+
+typedef std::chrono::steady_clock Clock;
+
+struct ReplayOptions {
+    std::string capturePath;
+    std::string host = "127.0.0.1";
+    uint16_t port = 5869;
+    double speed = 1.0;
+    bool maxSpeed = false;
+    int idBase = 1;
+    std::string comparePath; // 非空时只对比两个抓包文件
+};
+
+struct ReplayConnection {
+    uint32_t originalId = 0;
+    int fd = -1;
+    bool failed = false;        // 连接失败或被服务器关闭
+    bool closeRequested = false; // 抓包中的连接已关闭：收完响应后关闭
+    FrameDecoder decoder;
+    PacketCodec codec;
+    FragmentAssembler fragments;
+    std::string out;
+    size_t outPos = 0;
+    bool wantWrite = false;
+    std::deque<Clock::time_point> inFlight; // 等待响应的请求的发送时间
+};
+
+struct ReplayEvent {
+    uint64_t timeNs;
+    size_t conn;
+    const CaptureRecord* record;
+};
+
+struct ReplayStats {
+    std::vector<uint64_t> originalNs;  // 原始运行，服务器：开始处理 -> 处理完成
+    std::vector<uint64_t> replayNs;    // 重放，服务器：开始处理 -> 响应进入发送队列
+    std::vector<uint64_t> roundTripNs; // 重放，客户端：发出 -> 收到响应
+    uint64_t packetsSent = 0;
+    uint64_t bytesSent = 0;
+    uint64_t unsolicited = 0;   // 服务器主动推送的数据包（转发的消息等）
+    uint64_t lost = 0;          // 没有收到响应的请求
+    uint64_t connectFailures = 0;
+};
+
+static bool expectsResponse(uint32_t type) {
+    type &= PACKET_TYPE_MASK;
+    return type != GRANT_CREDIT && type != STREAM_CHUNK;
+}
+
+static bool isResponse(MessageType type) {
+    return type == RESPONSE || type == CLIENT_LIST || type == BACKPRESSURE;
+}
+
+static ReplayOptions parseArgs(int argc, char* argv[]) {
+    ReplayOptions options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        size_t eq = arg.find('=');
+        if (arg.compare(0, 2, "--") != 0 || eq == std::string::npos) {
+            throw std::invalid_argument("Unrecognized argument: " + arg);
+        }
+        std::string name = arg.substr(2, eq - 2);
+        std::string value = arg.substr(eq + 1);
+        if (name == "capture") {
+            options.capturePath = value;
+        } else if (name == "host") {
+            options.host = value;
+        } else if (name == "port") {
+            options.port = static_cast<uint16_t>(std::atoi(value.c_str()));
+        } else if (name == "speed") {
+            if (value == "max") {
+                options.maxSpeed = true;
+            } else {
+                options.speed = std::atof(value.c_str());
+                if (options.speed <= 0) {
+                    throw std::invalid_argument("--speed must be positive or 'max': " + value);
+                }
+            }
+        } else if (name == "id-base") {
+            options.idBase = std::atoi(value.c_str());
+        } else if (name == "compare") {
+            options.comparePath = value;
+        } else {
+            throw std::invalid_argument("Unknown option: --" + name);
+        }
+    }
+    if (options.capturePath.empty()) {
+        throw std::invalid_argument("--capture is required.");
+    }
+    return options;
+}
+
+static std::vector<CaptureRecord> loadCapture(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("Failed to open " + path);
+    }
+    std::string buffer((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (buffer.size() < CAPTURE_FILE_HEADER_SIZE || buffer.compare(0, 8, CAPTURE_MAGIC) != 0) {
+        throw std::runtime_error(path + " is not a capture file.");
+    }
+    std::vector<CaptureRecord> records;
+    size_t pos = CAPTURE_FILE_HEADER_SIZE;
+    CaptureRecord rec;
+    while (CaptureRecord::parse(buffer, pos, rec)) {
+        records.push_back(std::move(rec));
+    }
+    if (pos != buffer.size()) {
+        std::cerr << "Warning: ignored a truncated record at the end of " << path << std::endl;
+    }
+    return records;
+}
+
+// 抓包中的处理延迟：同一连接上按顺序处理，每条 DONE 对应最早一个未完成的 FRAME
+static void collectCapturedLatency(const std::vector<CaptureRecord>& records, std::vector<uint64_t>& samples) {
+    std::unordered_map<uint32_t, std::deque<const CaptureRecord*>> pending;
+    for (const CaptureRecord& rec : records) {
+        if (rec.kind == CAPTURE_FRAME) {
+            pending[rec.clientId].push_back(&rec);
+        } else if (rec.kind == CAPTURE_DONE) {
+            std::deque<const CaptureRecord*>& frames = pending[rec.clientId];
+            if (frames.empty()) {
+                continue;
+            }
+            const CaptureRecord* frame = frames.front();
+            frames.pop_front();
+            if (expectsResponse(frame->type)) {
+                samples.push_back(rec.timestampNs - frame->timestampNs);
+            }
+        }
+    }
+}
+
+// 把数据中的原始客户端 ID 改写为重放时的 ID
+static void remapIds(Packet& pkt, const std::unordered_map<uint32_t, uint32_t>& idMap) {
+    if (pkt.type == SEND_MESSAGE) {
+        size_t colon = pkt.data.find(':');
+        if (colon == std::string::npos || colon == 0) {
+            return;
+        }
+        auto it = idMap.find(static_cast<uint32_t>(std::strtoul(pkt.data.c_str(), nullptr, 10)));
+        if (it != idMap.end()) {
+            pkt.data.replace(0, colon, std::to_string(it->second));
+        }
+    } else if (pkt.type == STREAM_CHUNK && pkt.data.size() >= STREAM_HEADER_SIZE) {
+        auto it = idMap.find(StreamChunk::readU32(pkt.data, 0));
+        if (it != idMap.end()) {
+            StreamChunk::writeU32(pkt.data, 0, it->second);
+        }
+    }
+}
+
+class Replayer {
+public:
+    Replayer(const ReplayOptions& opts, ReplayStats& s) : options(opts), stats(s) {
+        epollFd = epoll_create1(EPOLL_CLOEXEC);
+        if (epollFd < 0) {
+            throw std::runtime_error("Failed to create epoll instance.");
+        }
+    }
+
+    ~Replayer() {
+        for (ReplayConnection& conn : connections) {
+            if (conn.fd >= 0) {
+                close(conn.fd);
+            }
+        }
+        close(epollFd);
+    }
+
+    void run(const std::vector<CaptureRecord>& records) {
+        buildSchedule(records);
+        Clock::time_point start = Clock::now();
+        size_t next = 0;
+        Clock::time_point drainDeadline;
+        while (true) {
+            Clock::time_point now = Clock::now();
+            while (next < events.size() && (options.maxSpeed || dueTime(start, events[next]) <= now)) {
+                handleEvent(events[next]);
+                next++;
+            }
+            int timeoutMs = 10;
+            if (next < events.size()) {
+                if (!options.maxSpeed) {
+                    auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(dueTime(start, events[next]) - now);
+                    timeoutMs = static_cast<int>(std::max<int64_t>(0, std::min<int64_t>(wait.count(), 10)));
+                }
+            } else {
+                if (drainDeadline == Clock::time_point()) {
+                    drainDeadline = now + std::chrono::milliseconds(REPLAY_DRAIN_TIMEOUT_MS);
+                }
+                if (allDrained() || now >= drainDeadline) {
+                    break;
+                }
+            }
+            poll(timeoutMs);
+        }
+        elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        for (ReplayConnection& conn : connections) {
+            stats.lost += conn.inFlight.size();
+        }
+    }
+
+    size_t connectionCount() const { return connections.size(); }
+    double elapsedSeconds() const { return elapsed; }
+
+private:
+    const ReplayOptions& options;
+    ReplayStats& stats;
+    int epollFd;
+    std::deque<ReplayConnection> connections; // 元素地址注册在 epoll 中，不能搬移
+    std::unordered_map<uint32_t, size_t> connByOriginalId;
+    std::unordered_map<uint32_t, uint32_t> idMap; // 原始客户端 ID -> 重放时的 ID
+    std::vector<ReplayEvent> events;
+    double elapsed = 0;
+
+    void buildSchedule(const std::vector<CaptureRecord>& records) {
+        // 抓包开始后才建立的连接才能完整重放；之前已存在的连接没有 OPEN 记录，其数据包忽略
+        uint64_t firstTime = 0;
+        for (const CaptureRecord& rec : records) {
+            if (rec.kind == CAPTURE_OPEN) {
+                if (connections.empty()) {
+                    firstTime = rec.timestampNs;
+                }
+                connByOriginalId[rec.clientId] = connections.size();
+                idMap[rec.clientId] = static_cast<uint32_t>(options.idBase + connections.size());
+                connections.emplace_back();
+                connections.back().originalId = rec.clientId;
+            }
+            if (rec.kind == CAPTURE_DONE) {
+                continue;
+            }
+            auto it = connByOriginalId.find(rec.clientId);
+            if (it == connByOriginalId.end()) {
+                continue;
+            }
+            events.push_back(ReplayEvent{rec.timestampNs - firstTime, it->second, &rec});
+        }
+    }
+
+    Clock::time_point dueTime(Clock::time_point start, const ReplayEvent& event) const {
+        return start + std::chrono::nanoseconds(static_cast<uint64_t>(event.timeNs / options.speed));
+    }
+
+    void handleEvent(const ReplayEvent& event) {
+        ReplayConnection& conn = connections[event.conn];
+        const CaptureRecord& rec = *event.record;
+        if (rec.kind == CAPTURE_OPEN) {
+            openConnection(conn);
+        } else if (rec.kind == CAPTURE_CLOSE) {
+            conn.closeRequested = true;
+            closeIfDone(conn);
+        } else if (rec.kind == CAPTURE_FRAME && conn.fd >= 0) {
+            Packet pkt;
+            pkt.type = static_cast<MessageType>(rec.type & PACKET_TYPE_MASK);
+            pkt.flags = rec.type & ~PACKET_TYPE_MASK & ~PACKET_FLAG_TRACE; // 抓包中没有追踪尾部
+            pkt.data = rec.data;
+            remapIds(pkt, idMap);
+            // 有响应的请求都带追踪，服务器在响应中带回开始处理和响应入队的时间
+            if (expectsResponse(rec.type)) {
+                traceStart(pkt, TRACE_CLIENT_SEND);
+            }
+            // 抓包中是解开流式压缩后的内容，按本连接协商的结果重新压缩（共享字典压缩的消息原样发送）
+            Packet encoded;
+            bool changed = (pkt.flags & ~PACKET_FLAG_TRACE) == 0 && conn.codec.encode(pkt, encoded);
+            conn.out += changed ? encoded.serialize() : pkt.serialize();
+            stats.packetsSent++;
+            stats.bytesSent += pkt.data.size() + 8;
+            if (expectsResponse(rec.type)) {
+                conn.inFlight.push_back(Clock::now());
+            }
+            if (pkt.type == HELLO) {
+                negotiating.insert(&conn);
+            }
+            flush(conn);
+        }
+    }
+
+    // 按顺序阻塞地建立连接，保证服务器按原顺序分配 ID
+    void openConnection(ReplayConnection& conn) {
+        conn.fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(options.port);
+        if (conn.fd < 0 || inet_pton(AF_INET, options.host.c_str(), &addr.sin_addr) <= 0 ||
+            ::connect(conn.fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0) {
+            stats.connectFailures++;
+            fail(conn);
+            return;
+        }
+        int one = 1;
+        setsockopt(conn.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        fcntl(conn.fd, F_SETFL, fcntl(conn.fd, F_GETFL, 0) | O_NONBLOCK);
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.ptr = &conn;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, conn.fd, &ev);
+    }
+
+    void poll(int timeoutMs) {
+        struct epoll_event ready[REPLAY_MAX_EVENTS];
+        int n = epoll_wait(epollFd, ready, REPLAY_MAX_EVENTS, timeoutMs);
+        for (int i = 0; i < n; i++) {
+            ReplayConnection& conn = *static_cast<ReplayConnection*>(ready[i].data.ptr);
+            if (ready[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                readResponses(conn);
+            }
+            if (conn.fd >= 0 && (ready[i].events & EPOLLOUT)) {
+                flush(conn);
+            }
+        }
+    }
+
+    void readResponses(ReplayConnection& conn) {
+        char buffer[REPLAY_READ_CHUNK];
+        while (conn.fd >= 0) {
+            ssize_t bytes = recv(conn.fd, buffer, sizeof(buffer), 0);
+            if (bytes > 0) {
+                conn.decoder.append(buffer, bytes);
+                Packet pkt;
+                try {
+                    while (conn.decoder.next(pkt)) {
+                        if (conn.fragments.add(pkt, conn.codec, DEFAULT_MAX_FRAME_SIZE)) {
+                            handlePacket(conn, pkt);
+                        }
+                    }
+                } catch (const std::exception& e) {
+                    std::cerr << "Connection of client " << conn.originalId << ": " << e.what() << std::endl;
+                    fail(conn);
+                    return;
+                }
+            } else if (bytes < 0 && errno == EINTR) {
+                continue;
+            } else if (bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                break;
+            } else {
+                fail(conn); // 服务器关闭了连接（例如处理完 DISCONNECT）
+                return;
+            }
+        }
+        closeIfDone(conn);
+    }
+
+    void handlePacket(ReplayConnection& conn, const Packet& pkt) {
+        if (!isResponse(pkt.type) || conn.inFlight.empty()) {
+            stats.unsolicited++;
+            return;
+        }
+        stats.roundTripNs.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            Clock::now() - conn.inFlight.front()).count());
+        conn.inFlight.pop_front();
+        uint64_t dispatched = 0;
+        uint64_t enqueued = 0;
+        for (const auto& [stage, ns] : traceParse(pkt.trace)) {
+            if (stage == TRACE_SERVER_DISPATCH) {
+                dispatched = ns;
+            } else if (stage == TRACE_SERVER_ENQUEUE && dispatched != 0) {
+                enqueued = ns;
+                break;
+            }
+        }
+        if (enqueued != 0) {
+            stats.replayNs.push_back(enqueued - dispatched);
+        }
+        // 重放的 HELLO 的响应决定之后的数据包是否压缩（与原客户端一致）
+        if (negotiating.erase(&conn) && pkt.type == RESPONSE && helloAccepted(pkt.data, COMPRESSION_CODEC)) {
+            conn.codec.enable(COMPRESS_MIN_BYTES);
+        }
+    }
+
+    void flush(ReplayConnection& conn) {
+        while (conn.fd >= 0 && conn.outPos < conn.out.size()) {
+            ssize_t sent = send(conn.fd, conn.out.data() + conn.outPos, conn.out.size() - conn.outPos, MSG_NOSIGNAL);
+            if (sent > 0) {
+                conn.outPos += sent;
+            } else if (sent < 0 && errno == EINTR) {
+                continue;
+            } else if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                break;
+            } else {
+                fail(conn);
+                return;
+            }
+        }
+        if (conn.fd < 0) {
+            return;
+        }
+        if (conn.outPos == conn.out.size()) {
+            conn.out.clear();
+            conn.outPos = 0;
+        }
+        bool needWrite = conn.outPos < conn.out.size();
+        if (needWrite != conn.wantWrite) {
+            conn.wantWrite = needWrite;
+            struct epoll_event ev;
+            memset(&ev, 0, sizeof(ev));
+            ev.events = needWrite ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+            ev.data.ptr = &conn;
+            epoll_ctl(epollFd, EPOLL_CTL_MOD, conn.fd, &ev);
+        }
+        closeIfDone(conn);
+    }
+
+    void closeIfDone(ReplayConnection& conn) {
+        if (conn.fd >= 0 && conn.closeRequested && conn.inFlight.empty() && conn.out.empty()) {
+            epoll_ctl(epollFd, EPOLL_CTL_DEL, conn.fd, nullptr);
+            close(conn.fd);
+            conn.fd = -1;
+        }
+    }
+
+    void fail(ReplayConnection& conn) {
+        if (conn.fd >= 0) {
+            epoll_ctl(epollFd, EPOLL_CTL_DEL, conn.fd, nullptr);
+            close(conn.fd);
+            conn.fd = -1;
+        }
+        conn.failed = true;
+        stats.lost += conn.inFlight.size();
+        conn.inFlight.clear();
+        negotiating.erase(&conn);
+    }
+
+    bool allDrained() const {
+        for (const ReplayConnection& conn : connections) {
+            if (conn.fd >= 0 && (!conn.inFlight.empty() || !conn.out.empty())) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::set<ReplayConnection*> negotiating; // 已发出 HELLO、尚未收到响应的连接
+};
+
+static std::string describeLatency(const char* name, std::vector<uint64_t>& samples) {
+    char line[256];
+    if (samples.empty()) {
+        snprintf(line, sizeof(line), "%-10s %8d %10s %10s %10s %10s %10s", name, 0, "-", "-", "-", "-", "-");
+        return line;
+    }
+    std::sort(samples.begin(), samples.end());
+    auto at = [&samples](double q) {
+        size_t index = static_cast<size_t>(q * (samples.size() - 1) + 0.5);
+        return samples[index] / 1000.0;
+    };
+    snprintf(line, sizeof(line), "%-10s %8zu %10.1f %10.1f %10.1f %10.1f %10.1f", name, samples.size(),
+             at(0.5), at(0.9), at(0.99), at(0.999), samples.back() / 1000.0);
+    return line;
+}
+
+int main(int argc, char* argv[]) {
+    ReplayOptions options;
+    std::vector<CaptureRecord> records;
+    try {
+        options = parseArgs(argc, argv);
+        records = loadCapture(options.capturePath);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n"
+                  << "Usage: " << argv[0] << " --capture=FILE [--host=127.0.0.1] [--port=5869] "
+                  << "[--speed=1|N|max] [--id-base=1]\n"
+                  << "       " << argv[0] << " --capture=FILE --compare=FILE" << std::endl;
+        return -1;
+    }
+
+    ReplayStats stats;
+    collectCapturedLatency(records, stats.originalNs);
+    if (!options.comparePath.empty()) {
+        std::vector<uint64_t> comparedNs;
+        try {
+            collectCapturedLatency(loadCapture(options.comparePath), comparedNs);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return -1;
+        }
+        std::cout << "Latency (us)     count        p50        p90        p99      p99.9        max" << std::endl;
+        std::cout << describeLatency("original", stats.originalNs) << "  (server: dispatch -> handled)" << std::endl;
+        std::cout << describeLatency("compared", comparedNs) << "  (server: dispatch -> handled)" << std::endl;
+        return 0;
+    }
+    Replayer replayer(options, stats);
+    try {
+        replayer.run(records);
+    } catch (const std::exception& e) {
+        std::cerr << "Replay failed: " << e.what() << std::endl;
+        return -1;
+    }
+
+    std::ostringstream speed;
+    if (options.maxSpeed) {
+        speed << "max";
+    } else {
+        speed << options.speed << "x";
+    }
+    std::cout << "Replayed " << stats.packetsSent << " packets (" << stats.bytesSent << " bytes) on "
+              << replayer.connectionCount() << " connections in " << replayer.elapsedSeconds()
+              << " s at " << speed.str() << " speed" << std::endl;
+    std::cout << "Latency (us)     count        p50        p90        p99      p99.9        max" << std::endl;
+    std::cout << describeLatency("original", stats.originalNs) << "  (server: dispatch -> handled)" << std::endl;
+    std::cout << describeLatency("replay", stats.replayNs) << "  (server: dispatch -> response queued)" << std::endl;
+    std::cout << describeLatency("round-trip", stats.roundTripNs) << "  (replay client: sent -> response)" << std::endl;
+    std::cout << "Lost responses: " << stats.lost << ", unsolicited packets: " << stats.unsolicited
+              << ", failed connections: " << stats.connectFailures << std::endl;
+    return stats.lost == 0 && stats.connectFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,249 @@
+// ScanBench.cpp
+// Message/Scan.h 各实现与标量版本的对比测试
+//
+// 用法: scan_bench [--seconds=0.2] [--fuzz=200000]
+// - 文本校验：ASCII 聊天、中英混合、含 4 字节字符的文本，分别在 64 字节、1 KiB、64 KiB 上比较
+//   标量 / SSE2 / AVX2（CPU 支持时）的吞吐
+// - 分隔符查找：逐字节循环与 std::string::find（memchr）
+// - 帧边界：一个 64 KiB 的 PEER_BATCH 用 scanFrames + loadFrame 与 FrameDecoder 逐帧取出
+// - 先用随机生成并随机破坏的文本交叉检查各实现与标量版本的结果，不一致时以非零状态退出
+// - 吞吐数字只在优化构建下有意义：cmake -DCMAKE_BUILD_TYPE=Release
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "Message/FrameDecoder.h"
+#include "Message/Scan.h"
+
+typedef std::chrono::steady_clock Clock;
+
+struct ScanBenchOptions {
+    double seconds = 0.2; // 每项测量的时长
+    int fuzz = 200000;    // 交叉检查的输入个数
+};
+
+static ScanBenchOptions parseArgs(int argc, char* argv[]) {
+    ScanBenchOptions options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        size_t eq = arg.find('=');
+        if (arg.compare(0, 2, "--") != 0 || eq == std::string::npos) {
+            throw std::invalid_argument("Unrecognized argument: " + arg);
+        }
+        std::string name = arg.substr(2, eq - 2);
+        std::string value = arg.substr(eq + 1);
+        if (name == "seconds") {
+            options.seconds = std::atof(value.c_str());
+        } else if (name == "fuzz") {
+            options.fuzz = std::atoi(value.c_str());
+        } else {
+            throw std::invalid_argument("Unknown option: --" + name);
+        }
+    }
+    if (options.seconds <= 0 || options.fuzz < 0) {
+        throw std::invalid_argument("--seconds must be positive and --fuzz not negative.");
+    }
+    return options;
+}
+
+struct Kernel {
+    const char* name;
+    TextValidator fn;
+};
+
+static std::vector<Kernel> availableKernels() {
+    std::vector<Kernel> kernels = {{"scalar", isValidTextScalar}};
+#ifdef SCAN_X86
+    kernels.push_back({"sse2", isValidTextSse2});
+    if (__builtin_cpu_supports("avx2")) {
+        kernels.push_back({"avx2", isValidTextAvx2});
+    }
+#endif
+    return kernels;
+}
+
+// 随机文本：asciiPercent% 的字符是可打印 ASCII，其余是 2/3/4 字节字符（maxBytes 限制最长编码）
+static std::string makeText(std::mt19937& rng, size_t bytes, int asciiPercent, int maxBytes) {
+    static const char* samples[] = {"é", "ü", "ж", "中", "文", "消", "息", "€", "😀", "𝄞"};
+    static const int sampleBytes[] = {2, 2, 2, 3, 3, 3, 3, 3, 4, 4};
+    std::string text;
+    while (text.size() < bytes) {
+        if (static_cast<int>(rng() % 100) < asciiPercent) {
+            text += static_cast<char>(0x20 + rng() % 95);
+        } else {
+            size_t index = rng() % 10;
+            if (sampleBytes[index] <= maxBytes) {
+                text += samples[index];
+            }
+        }
+    }
+    text.resize(bytes);
+    // 去掉末尾被截断的多字节字符，用 ASCII 补齐长度
+    while (!isValidTextScalar(text.data(), text.size())) {
+        text.pop_back();
+    }
+    text.resize(bytes, 'x');
+    return text;
+}
+
+// 交叉检查：合法文本上随机改写 0-3 个字节（偏向边界值）
+static int crossCheck(int count) {
+    std::vector<Kernel> kernels = availableKernels();
+    std::mt19937 rng(12345);
+    static const uint8_t interesting[] = {0x00, 0x09, 0x0A, 0x0D, 0x1B, 0x1F, 0x20, 0x7E, 0x7F, 0x80, 0x9B, 0x9F,
+                                          0xA0, 0xBF, 0xC0, 0xC1, 0xC2, 0xDF, 0xE0, 0xED, 0xEF, 0xF0, 0xF4, 0xF5, 0xFF};
+    int mismatches = 0;
+    int invalid = 0;
+    for (int i = 0; i < count; i++) {
+        std::string text = makeText(rng, rng() % 200, static_cast<int>(rng() % 101), 4);
+        int edits = text.empty() ? 0 : rng() % 4;
+        for (int e = 0; e < edits; e++) {
+            uint8_t value = rng() % 2 ? interesting[rng() % sizeof(interesting)] : static_cast<uint8_t>(rng());
+            text[rng() % text.size()] = static_cast<char>(value);
+        }
+        bool expected = isValidTextScalar(text.data(), text.size());
+        invalid += !expected;
+        for (const Kernel& kernel : kernels) {
+            if (kernel.fn(text.data(), text.size()) != expected) {
+                if (mismatches++ < 10) {
+                    std::cerr << kernel.name << " disagrees with scalar on a " << text.size() << "-byte input" << std::endl;
+                }
+            }
+        }
+    }
+    std::cout << "Cross-check: " << count << " inputs (" << invalid << " invalid), " << mismatches << " mismatches"
+              << std::endl;
+    return mismatches;
+}
+
+// 重复执行 fn 至少 seconds 秒，返回每次的平均纳秒数
+static double measure(double seconds, const std::function<void()>& fn) {
+    uint64_t iterations = 0;
+    Clock::time_point start = Clock::now();
+    Clock::time_point deadline = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+    Clock::time_point now;
+    do {
+        for (int i = 0; i < 64; i++) {
+            fn();
+        }
+        iterations += 64;
+        now = Clock::now();
+    } while (now < deadline);
+    return std::chrono::duration<double, std::nano>(now - start).count() / iterations;
+}
+
+static volatile size_t sink; // 防止被测代码被优化掉
+
+static void benchText(const ScanBenchOptions& options) {
+    struct Corpus {
+        const char* name;
+        int asciiPercent;
+        int maxBytes;
+    };
+    const Corpus corpora[] = {{"ascii", 100, 1}, {"zh-mixed", 50, 3}, {"emoji", 80, 4}};
+    const size_t sizes[] = {64, 1024, 64 << 10};
+    std::vector<Kernel> kernels = availableKernels();
+    std::mt19937 rng(42);
+
+    std::cout << "\nText validation (GB/s)" << std::endl;
+    printf("%-10s %8s", "corpus", "bytes");
+    for (const Kernel& kernel : kernels) {
+        printf(" %10s", kernel.name);
+    }
+    printf(" %10s\n", "speedup");
+    for (const Corpus& corpus : corpora) {
+        for (size_t size : sizes) {
+            std::string text = makeText(rng, size, corpus.asciiPercent, corpus.maxBytes);
+            printf("%-10s %8zu", corpus.name, size);
+            double scalarNs = 0;
+            double bestNs = 0;
+            for (const Kernel& kernel : kernels) {
+                double ns = measure(options.seconds, [&] { sink = kernel.fn(text.data(), text.size()); });
+                scalarNs = scalarNs == 0 ? ns : scalarNs;
+                bestNs = ns;
+                printf(" %10.2f", text.size() / ns);
+            }
+            printf(" %9.1fx\n", scalarNs / bestNs);
+        }
+    }
+}
+
+static void benchDelimiter(const ScanBenchOptions& options) {
+    std::cout << "\nDelimiter search, ':' at the end (GB/s)" << std::endl;
+    printf("%8s %10s %10s\n", "bytes", "loop", "find");
+    for (size_t size : {16, 256, 4096, 65536}) {
+        std::string text(size - 1, 'a');
+        text += ':';
+        double loopNs = measure(options.seconds, [&] {
+            const char* p = text.data();
+            size_t i = 0;
+            while (i < text.size() && p[i] != ':') {
+                i++;
+            }
+            sink = i;
+        });
+        double findNs = measure(options.seconds, [&] { sink = text.find(':'); });
+        printf("%8zu %10.2f %10.2f\n", size, size / loopNs, size / findNs);
+    }
+}
+
+static void benchFrames(const ScanBenchOptions& options) {
+    std::cout << "\nFrame walk over a 64 KiB batch (ns per frame)" << std::endl;
+    printf("%8s %8s %12s %12s\n", "data", "frames", "decoder", "scanFrames");
+    for (size_t dataBytes : {16, 100, 1000}) {
+        std::string batch;
+        Packet pkt;
+        pkt.type = SEND_MESSAGE;
+        pkt.data.assign(dataBytes, 'x');
+        std::string frame = pkt.serialize();
+        while (batch.size() + frame.size() <= (64 << 10)) {
+            batch += frame;
+        }
+        size_t frames = batch.size() / frame.size();
+        double decoderNs = measure(options.seconds, [&] {
+            FrameDecoder decoder;
+            Packet inner;
+            size_t count = 0;
+            decoder.append(batch.data(), batch.size());
+            while (decoder.next(inner)) {
+                count += inner.data.size();
+            }
+            sink = count;
+        });
+        std::vector<FrameSpan> spans;
+        double scanNs = measure(options.seconds, [&] {
+            Packet inner;
+            size_t count = 0;
+            spans.clear();
+            scanFrames(batch.data(), batch.size(), DEFAULT_MAX_FRAME_SIZE, spans);
+            for (const FrameSpan& span : spans) {
+                loadFrame(batch.data(), span, inner);
+                count += inner.data.size();
+            }
+            sink = count;
+        });
+        printf("%8zu %8zu %12.1f %12.1f\n", dataBytes, frames, decoderNs / frames, scanNs / frames);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    ScanBenchOptions options;
+    try {
+        options = parseArgs(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n"
+                  << "Usage: " << argv[0] << " [--seconds=0.2] [--fuzz=200000]" << std::endl;
+        return -1;
+    }
+    std::cout << "isValidText uses " << textScanImplementation() << std::endl;
+    int mismatches = crossCheck(options.fuzz);
+    benchText(options);
+    benchDelimiter(options);
+    benchFrames(options);
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,56 @@
+#!/bin/bash
+
+# 依次以不同模式启动服务器，用 latency_bench 测量往返延迟，并统计服务器消耗的 CPU 时间
+# 用法：./run_bench.sh [latency_bench 的额外参数...]，例如 ./run_bench.sh --connections=4 --gap-us=200
+# 环境变量：IO_CPUS / ACCEPT_CPUS 为服务器线程绑定的 CPU，CLIENT_CPUS 为测试客户端的 CPU（需要 taskset，设为空则不绑定），
+#           SPIN_US、BUSY_POLL_US 为低延迟模式的参数，PORT 为测试端口
+
+PROJECT_DIR=$(pwd)
+SERVER=${PROJECT_DIR}/build/server
+BENCH=${PROJECT_DIR}/build/latency_bench
+
+PORT=${PORT:-5999}
+IO_CPUS=${IO_CPUS:-0}
+ACCEPT_CPUS=${ACCEPT_CPUS:-1}
+CLIENT_CPUS=${CLIENT_CPUS-2-3}
+SPIN_US=${SPIN_US:-200}
+BUSY_POLL_US=${BUSY_POLL_US:-50}
+
+PINNED="--io-cpus=${IO_CPUS} --accept-cpus=${ACCEPT_CPUS}"
+MODES=(
+    "default|"
+    "pinned|${PINNED}"
+    "spin|${PINNED} --spin=${SPIN_US}"
+    "busy-poll|${PINNED} --busy-poll=${BUSY_POLL_US}"
+    "spin+busy-poll|${PINNED} --spin=${SPIN_US} --busy-poll=${BUSY_POLL_US}"
+)
+
+CLIENT_PREFIX=""
+if command -v taskset >/dev/null 2>&1 && [ -n "${CLIENT_CPUS}" ]; then
+    CLIENT_PREFIX="taskset -c ${CLIENT_CPUS}"
+fi
+
+# 进程已消耗的 CPU 时间（秒，用户态 + 内核态）
+cpu_seconds() {
+    awk -v hz=$(getconf CLK_TCK) '{ printf "%.2f", ($14 + $15) / hz }' /proc/$1/stat
+}
+
+for mode in "${MODES[@]}"
+do
+    name=${mode%%|*}
+    flags=${mode#*|}
+    ${SERVER} --port=${PORT} --conn-rate=0:0 --stats-interval=0 ${flags} >/dev/null 2>&1 &
+    pid=$!
+    sleep 1
+    if ! kill -0 ${pid} 2>/dev/null; then
+        echo "== ${name}: 服务器启动失败（${flags}）"
+        continue
+    fi
+    before=$(cpu_seconds ${pid})
+    echo "== ${name} ${flags}"
+    ${CLIENT_PREFIX} ${BENCH} --port=${PORT} "$@"
+    after=$(cpu_seconds ${pid})
+    echo "server_cpu $(awk -v a=${after} -v b=${before} 'BEGIN { printf "%.2f", a - b }') s"
+    kill -INT ${pid}
+    wait ${pid} 2>/dev/null
+done
@@ -0,0 +1,33 @@
+#!/bin/bash
+
+# 在本机回环地址上启动一个多节点集群
+# 节点 i 的客户端端口为 BASE_PORT+i，节点间端口为 PEER_BASE_PORT+i
+# 用法：./run_cluster.sh [节点数]，客户端使用 ./build/client --port=<节点的客户端端口> 连接
+
+PROJECT_DIR=$(pwd)
+SERVER=${PROJECT_DIR}/build/server
+
+NODE_COUNT=${1:-3}
+BASE_PORT=7000
+PEER_BASE_PORT=8000
+
+# 所有节点使用同一个 --peers 列表（其中的本节点会被忽略）
+PEERS=""
+for ((i=1; i<=NODE_COUNT; i++))
+do
+    PEERS="${PEERS}${PEERS:+,}${i}@127.0.0.1:$((PEER_BASE_PORT+i))"
+done
+
+PIDS=()
+for ((i=1; i<=NODE_COUNT; i++))
+do
+    echo "启动节点 $i（客户端端口 $((BASE_PORT+i))）..."
+    ${SERVER} --port=$((BASE_PORT+i)) --node-id=${i} --peer-port=$((PEER_BASE_PORT+i)) --peers=${PEERS} &
+    PIDS+=($!)
+done
+
+# Ctrl + C 时关闭所有节点
+trap 'kill -INT ${PIDS[@]} 2>/dev/null' INT TERM
+wait
+
+echo "集群已关闭。"